@@ -0,0 +1,242 @@
+#pragma once
+
+#include "bigNumber.h"
+#include <type_traits>
+
+// Opt-in lazy arithmetic over BigNumber
+//
+// lazy(a) * b - c builds an expression tree instead of a chain of truncated
+// temporaries. The tree is evaluated in one pass when it is converted to a
+// BigNumber: sums and products are exact, quotients are truncated to the
+// working precision and the final result is truncated once.
+//
+// Leaves hold references to their BigNumbers, so an expression has to be
+// evaluated within the full expression that builds it.
+namespace BigNumExpr
+{
+    struct AddOp
+    {
+    };
+    struct SubOp
+    {
+    };
+    struct MulOp
+    {
+    };
+    struct DivOp
+    {
+    };
+
+    // Integer literals keep their exact value instead of going through double
+    template <typename T>
+    using IfInteger = typename std::enable_if<std::is_integral<T>::value, int>::type;
+
+    template <typename Derived> class Expr
+    {
+    public:
+        const Derived &self() const
+        {
+            return static_cast<const Derived &>(*this);
+        }
+
+        operator BigNumber() const;
+    };
+
+    // Leaf referring to an existing number
+    class Ref : public Expr<Ref>
+    {
+    public:
+        explicit Ref(const BigNumber &value) : _value(value)
+        {
+        }
+
+        const BigNumber &value() const
+        {
+            return _value;
+        }
+
+    private:
+        const BigNumber &_value;
+    };
+
+    // Leaf owning a converted literal, integers are converted exactly
+    class Constant : public Expr<Constant>
+    {
+    public:
+        explicit Constant(double value) : _value(value)
+        {
+        }
+        template <typename T, IfInteger<T> = 0> explicit Constant(T value) : _value(value)
+        {
+        }
+
+        const BigNumber &value() const
+        {
+            return _value;
+        }
+
+    private:
+        BigNumber _value;
+    };
+
+    template <typename Op, typename L, typename R> class Binary : public Expr<Binary<Op, L, R>>
+    {
+    public:
+        Binary(const L &left, const R &right) : _left(left), _right(right)
+        {
+        }
+
+        const L &left() const
+        {
+            return _left;
+        }
+        const R &right() const
+        {
+            return _right;
+        }
+
+    private:
+        L _left;
+        R _right;
+    };
+
+    // Walks an expression tree, sums accumulate into the result of their left
+    // operand and products and quotients of inner nodes go through temporaries
+    class Evaluator
+    {
+    public:
+        // `out` must not be referenced by the expression
+        template <typename E> void evaluate(const Expr<E> &expr, BigNumber &out)
+        {
+            evaluateNode(expr.self(), out);
+            out.truncateInPlace(BigNumber::workingPrecision());
+        }
+
+    private:
+        void evaluateNode(const Ref &node, BigNumber &out)
+        {
+            out = node.value();
+        }
+
+        void evaluateNode(const Constant &node, BigNumber &out)
+        {
+            out = node.value();
+        }
+
+        template <typename L, typename R>
+        void evaluateNode(const Binary<AddOp, L, R> &node, BigNumber &out)
+        {
+            evaluateNode(node.left(), out);
+            accumulate(node.right(), out, false);
+        }
+
+        template <typename L, typename R>
+        void evaluateNode(const Binary<SubOp, L, R> &node, BigNumber &out)
+        {
+            evaluateNode(node.left(), out);
+            accumulate(node.right(), out, true);
+        }
+
+        template <typename L, typename R>
+        void evaluateNode(const Binary<MulOp, L, R> &node, BigNumber &out)
+        {
+            BigNumber leftValue, rightValue;
+            const BigNumber &left = operand(node.left(), leftValue);
+            const BigNumber &right = operand(node.right(), rightValue);
+
+            out = BigNumber::multiply(left, right, BigNumber::EXACT_PRECISION);
+        }
+
+        template <typename L, typename R>
+        void evaluateNode(const Binary<DivOp, L, R> &node, BigNumber &out)
+        {
+            BigNumber leftValue, rightValue;
+            const BigNumber &left = operand(node.left(), leftValue);
+            const BigNumber &right = operand(node.right(), rightValue);
+
+            out = BigNumber::divide(left, right, BigNumber::workingPrecision());
+        }
+
+        template <typename Node> void accumulate(const Node &node, BigNumber &out, bool subtract)
+        {
+            BigNumber value;
+
+            out.addInPlace(operand(node, value), subtract, BigNumber::EXACT_PRECISION);
+        }
+
+        // Leaves are used directly, inner nodes are evaluated into `value`
+        const BigNumber &operand(const Ref &node, BigNumber &)
+        {
+            return node.value();
+        }
+
+        const BigNumber &operand(const Constant &node, BigNumber &)
+        {
+            return node.value();
+        }
+
+        template <typename Node> const BigNumber &operand(const Node &node, BigNumber &value)
+        {
+            evaluateNode(node, value);
+            return value;
+        }
+    };
+
+    inline Ref lazy(const BigNumber &value)
+    {
+        return Ref(value);
+    }
+
+    template <typename E> BigNumber eval(const Expr<E> &expr)
+    {
+        BigNumber res;
+        Evaluator().evaluate(expr, res);
+
+        return res;
+    }
+
+    template <typename Derived> Expr<Derived>::operator BigNumber() const
+    {
+        return eval(*this);
+    }
+
+#define BIGNUM_EXPR_OPERATOR(op, Op)                                                           \
+    template <typename L, typename R>                                                          \
+    Binary<Op, L, R> operator op(const Expr<L> &left, const Expr<R> &right)                    \
+    {                                                                                          \
+        return Binary<Op, L, R>(left.self(), right.self());                                    \
+    }                                                                                          \
+    template <typename L> Binary<Op, L, Ref> operator op(const Expr<L> &left, const BigNumber &right) \
+    {                                                                                          \
+        return Binary<Op, L, Ref>(left.self(), Ref(right));                                    \
+    }                                                                                          \
+    template <typename R> Binary<Op, Ref, R> operator op(const BigNumber &left, const Expr<R> &right) \
+    {                                                                                          \
+        return Binary<Op, Ref, R>(Ref(left), right.self());                                    \
+    }                                                                                          \
+    template <typename L> Binary<Op, L, Constant> operator op(const Expr<L> &left, double right) \
+    {                                                                                          \
+        return Binary<Op, L, Constant>(left.self(), Constant(right));                          \
+    }                                                                                          \
+    template <typename R> Binary<Op, Constant, R> operator op(double left, const Expr<R> &right) \
+    {                                                                                          \
+        return Binary<Op, Constant, R>(Constant(left), right.self());                          \
+    }                                                                                          \
+    template <typename L, typename T, IfInteger<T> = 0>                                        \
+    Binary<Op, L, Constant> operator op(const Expr<L> &left, T right)                          \
+    {                                                                                          \
+        return Binary<Op, L, Constant>(left.self(), Constant(right));                          \
+    }                                                                                          \
+    template <typename T, typename R, IfInteger<T> = 0>                                        \
+    Binary<Op, Constant, R> operator op(T left, const Expr<R> &right)                          \
+    {                                                                                          \
+        return Binary<Op, Constant, R>(Constant(left), right.self());                          \
+    }
+
+    BIGNUM_EXPR_OPERATOR(+, AddOp)
+    BIGNUM_EXPR_OPERATOR(-, SubOp)
+    BIGNUM_EXPR_OPERATOR(*, MulOp)
+    BIGNUM_EXPR_OPERATOR(/, DivOp)
+
+#undef BIGNUM_EXPR_OPERATOR
+}
@@ -1,10 +1,20 @@
 #include "bigNumFn.h"
+#include "bigNumExpr.h"
+#include "bigNumMod.h"
 #include "bigNumber.h"
+#include "limbArith.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
 #include <exception>
 #include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
 
 using namespace std;
+using BigNumExpr::lazy;
 
 // Internal variables
 namespace
@@ -18,14 +28,850 @@ namespace
            "825342117067982148086513282306647093844609550582231725359408128481117450284102701938521"
            "105559644622948954930381964428810975665933446128475648233786783165271201909145648566923"
            "4603486104543266482133936072602491412737245870066063155881748815209209628");
+    // ln2 and ln10 are stored to LN_CONSTANT_DIGITS digits and computed
+    // when more are asked for
     const BigNumber ln2 =
         string("0."
                "69314718055994530941723212145817656807550013436025525412068000949339362"
-               "19696947156058633269964186875");
+               "19696947156058633269964186875420014810205706857336855202357581305570326"
+               "70751635075961930727570828371435190307038623891673471123350115364497");
+    const BigNumber ln10 =
+        string("2."
+               "30258509299404568401799145468436420760110148862877297603332790096757260"
+               "96773524802359972050895982983419677840422862486334095254650828067566662"
+               "87369098781689482907208325554680843799894826233198528393505308965377");
+    const int LN_CONSTANT_DIGITS = 210;
+
     const int sinIterations = 60;
-    const int lnIterations = 80;
-    const int sqRootIterations = 15;
 
+    // Extra digits carried by sqroot and ln to absorb truncation errors
+    const int GUARD_DIGITS = 10;
+
+    // Working precision for a result which has to be correct to `digits` digits
+    int guardedPrecision(int64_t digits)
+    {
+        digits += GUARD_DIGITS;
+        if (digits > INT32_MAX / 2)
+            throw logic_error("Input is out of range");
+        return digits < GUARD_DIGITS ? GUARD_DIGITS : (int)digits;
+    }
+
+    // ln((1 + t) / (1 - t)) = 2 * (t + t^3/3 + t^5/5 + ...) for |t| < 1
+    BigNumber lnSeries(const BigNumber &t, int precision)
+    {
+        BigNumber tSquared = BigNumber::mul(t, t, precision);
+        BigNumber power = t;
+        BigNumber res = 0;
+
+        for (int i = 0; power != 0; i++)
+        {
+            res = BigNumber::add(res, BigNumber::div(power, 2 * i + 1, precision), precision);
+            power = BigNumber::mul(power, tSquared, precision);
+        }
+
+        return BigNumber::mul(res, two, precision);
+    }
+
+    // ln2 = ln((1 + 1/3) / (1 - 1/3))
+    BigNumber ln2To(int precision)
+    {
+        if (precision <= LN_CONSTANT_DIGITS)
+            return ln2.truncate(precision);
+        return lnSeries(BigNumber::div(one, 3, precision), precision);
+    }
+
+    // ln10 = 3 * ln2 + ln((1 + 1/9) / (1 - 1/9))
+    BigNumber ln10To(int precision)
+    {
+        if (precision <= LN_CONSTANT_DIGITS)
+            return ln10.truncate(precision);
+        return BigNumber::add(BigNumber::mul(ln2To(precision), 3, precision),
+                              lnSeries(BigNumber::div(one, 9, precision), precision), precision);
+    }
+
+    // Primes below `limit` by the sieve of Eratosthenes
+    vector<uint32_t> sievePrimes(uint32_t limit)
+    {
+        vector<bool> composite(limit, false);
+        vector<uint32_t> primes;
+
+        for (uint32_t i = 2; i < limit; i++)
+        {
+            if (composite[i])
+                continue;
+            primes.push_back(i);
+            for (uint64_t j = (uint64_t)i * i; j < limit; j += i)
+                composite[j] = true;
+        }
+        return primes;
+    }
+
+    // Trial division settles every number below SMALL_PRIME_LIMIT^2
+    const uint32_t SMALL_PRIME_LIMIT = 1000;
+    const vector<uint32_t> smallPrimes = sievePrimes(SMALL_PRIME_LIMIT);
+
+    // x mod p for every p in `primes`, one remainder by a product of several
+    // primes, which still fits a machine word, serves all of them
+    vector<uint32_t> residues(const BigNumber &x, const vector<uint32_t> &primes)
+    {
+        vector<uint32_t> res(primes.size());
+        for (size_t i = 0; i < primes.size();)
+        {
+            uint64_t product = 1;
+            size_t end = i;
+            while (end < primes.size() && product <= UINT64_MAX / primes[end])
+                product *= primes[end++];
+
+            uint64_t rem = x.remainderSmall(product);
+            for (; i < end; i++)
+                res[i] = rem % primes[i];
+        }
+        return res;
+    }
+
+    // Whether an integer n > 1 has a factor in smallPrimes other than itself
+    bool hasSmallFactor(const BigNumber &n)
+    {
+        vector<uint32_t> rem = residues(n, smallPrimes);
+        for (size_t i = 0; i < smallPrimes.size(); i++)
+        {
+            if (rem[i] == 0 && n != smallPrimes[i])
+                return true;
+        }
+        return false;
+    }
+
+    // Binary digits of an integer x >= 0, least significant first
+    vector<bool> binaryDigits(BigNumber x)
+    {
+        const uint64_t WORD = 1ULL << 32;
+
+        vector<bool> bits;
+        BigNumber rem;
+        while (x != 0)
+        {
+            x = BigNumber::divMod(x, WORD, rem);
+            uint64_t word = rem.remainderSmall(WORD);
+            for (int i = 0; i < 32; i++)
+                bits.push_back((word >> i) & 1);
+        }
+
+        while (!bits.empty() && !bits.back())
+            bits.pop_back();
+        return bits;
+    }
+
+    // Jacobi symbol (a / n) for an odd n > 0
+    int jacobi(int64_t a, const BigNumber &n)
+    {
+        int res = 1;
+
+        // (-1 / n) and (2 / n) depend on n mod 4 and n mod 8
+        if (a < 0)
+        {
+            a = -a;
+            if (n.remainderSmall(4) == 3)
+                res = -res;
+        }
+        int nMod8 = (int)n.remainderSmall(8);
+        for (; a != 0 && a % 2 == 0; a /= 2)
+        {
+            if (nMod8 == 3 || nMod8 == 5)
+                res = -res;
+        }
+
+        // by reciprocity (a / n) = (n mod a / a) up to sign, the rest takes
+        // machine words
+        if (a % 4 == 3 && nMod8 % 4 == 3)
+            res = -res;
+        uint64_t x = a == 0 ? 0 : n.remainderSmall(a);
+        uint64_t m = a;
+
+        while (x != 0)
+        {
+            for (; x % 2 == 0; x /= 2)
+            {
+                if (m % 8 == 3 || m % 8 == 5)
+                    res = -res;
+            }
+            swap(x, m);
+            if (x % 4 == 3 && m % 4 == 3)
+                res = -res;
+            x %= m;
+        }
+
+        return m == 1 ? res : 0;
+    }
+
+    // With n - 1 = d * 2^s and d odd, base^d = 1 or base^(d * 2^r) = -1
+    // mod n for some r < s
+    bool isStrongProbablePrime(const BigNumber &n, const BigNumFn::ModContext &mod,
+                               const BigNumber &base)
+    {
+        BigNumber nMinusOne = n - 1;
+        BigNumber d = nMinusOne;
+        int s = 0;
+        for (; !d.isOdd(); s++)
+            d /= 2;
+
+        BigNumber x = mod.pow(base, d);
+        if (x == 1 || x == nMinusOne)
+            return true;
+
+        for (int r = 1; r < s; r++)
+        {
+            x = mod.square(x);
+            if (x == nMinusOne)
+                return true;
+            if (x == 1)
+                return false;
+        }
+        return false;
+    }
+
+    // floor(sqrt(n)) for an integer n >= 0 by Newton's method on integers,
+    // x -> (x + n / x) / 2 decreases from any x above the root until it
+    // reaches it
+    BigNumber integerSqroot(const BigNumber &n)
+    {
+        if (n == 0)
+            return 0;
+
+        BigNumber rem;
+        BigNumber x = one.scaleByPowerOfTen((n.orderOfMagnitude() + 1) / 2);
+        for (;;)
+        {
+            BigNumber next = BigNumber::divMod(x + BigNumber::divMod(n, x, rem), two, rem);
+            if (next >= x)
+                return x;
+            swap(x, next);
+        }
+    }
+
+    // x / 2 mod n for a residue x, adding n first when x is odd
+    BigNumber halve(const BigNumber &x, const BigNumber &n)
+    {
+        return x.isOdd() ? (x + n) / 2 : x / 2;
+    }
+
+    // Strong Lucas test with Selfridge's parameters: the first D in 5, -7,
+    // 9, -11, ... with (D / n) = -1, P = 1 and Q = (1 - D) / 4. With
+    // n + 1 = d * 2^s and d odd, U_d = 0 or V_(d * 2^r) = 0 mod n for some
+    // r < s. Requires an odd n with no small factors
+    bool isStrongLucasProbablePrime(const BigNumber &n, const BigNumFn::ModContext &mod)
+    {
+        int64_t D = 5;
+        for (int tries = 0;; tries++)
+        {
+            int symbol = jacobi(D, n);
+            if (symbol == -1)
+                break;
+            if (symbol == 0)
+                return false;
+
+            // (D / n) is never -1 for a square n
+            if (tries == 10)
+            {
+                BigNumber root = integerSqroot(n);
+                if (root * root == n)
+                    return false;
+            }
+            D = D > 0 ? -(D + 2) : -D + 2;
+        }
+        int64_t Q = (1 - D) / 4;
+
+        BigNumber d = n + 1;
+        int s = 0;
+        for (; !d.isOdd(); s++)
+            d /= 2;
+        vector<bool> bits = binaryDigits(d);
+
+        // U_1 = 1, V_1 = P, from which k doubles every step and grows by
+        // one on a set bit:
+        // U_2k = U_k V_k, V_2k = V_k^2 - 2 Q^k,
+        // U_(k + 1) = (P U_k + V_k) / 2, V_(k + 1) = (D U_k + P V_k) / 2
+        BigNumber U = 1;
+        BigNumber V = 1;
+        BigNumber Qk = mod.reduce(Q);
+
+        for (size_t i = bits.size() - 1; i-- > 0;)
+        {
+            U = mod.mul(U, V);
+            V = mod.reduce(mod.square(V) - Qk * 2);
+            Qk = mod.square(Qk);
+
+            if (bits[i])
+            {
+                BigNumber next = halve(mod.reduce(U + V), n);
+                V = halve(mod.reduce(U * D + V), n);
+                U = next;
+                Qk = mod.mul(Qk, Q);
+            }
+        }
+
+        if (U == 0 || V == 0)
+            return true;
+
+        for (int r = 1; r < s; r++)
+        {
+            V = mod.reduce(mod.square(V) - Qk * 2);
+            if (V == 0)
+                return true;
+            Qk = mod.square(Qk);
+        }
+        return false;
+    }
+
+    // The probable prime tests of Baillie-PSW for an n with no small factors
+    bool passesBailliePsw(const BigNumber &n)
+    {
+        BigNumFn::ModContext mod(n);
+        return isStrongProbablePrime(n, mod, two) && isStrongLucasProbablePrime(n, mod);
+    }
+
+    // Candidate windows are sieved by the primes below SIEVE_PRIME_LIMIT
+    const uint32_t SIEVE_PRIME_LIMIT = 1 << 16;
+    const vector<uint32_t> sievingPrimes = sievePrimes(SIEVE_PRIME_LIMIT);
+
+    // Odd candidates per window of primesInRange
+    const size_t SIEVE_WINDOW = 1 << 16;
+
+    // Offsets i < count of the odd candidates base + 2i, base odd and at
+    // least 3, which have no factor among sievingPrimes but themselves
+    vector<size_t> sieveWindow(const BigNumber &base, size_t count)
+    {
+        vector<bool> crossed(count, false);
+        vector<uint32_t> rem = residues(base, sievingPrimes);
+
+        // only a window starting below the limit can hold a sieving prime
+        uint64_t smallBase = base < SIEVE_PRIME_LIMIT ? base.remainderSmall(SIEVE_PRIME_LIMIT) : 0;
+
+        // 2 is skipped, the candidates are odd
+        for (size_t k = 1; k < sievingPrimes.size(); k++)
+        {
+            uint64_t p = sievingPrimes[k];
+
+            // base + 2i = 0 mod p, where halving -base mod p takes adding
+            // p first when it is odd
+            uint64_t i = (p - rem[k]) % p;
+            if (i % 2)
+                i += p;
+            i /= 2;
+
+            if (smallBase + 2 * i == p)
+                i += p;
+            for (; i < count; i += p)
+                crossed[i] = true;
+        }
+
+        vector<size_t> survivors;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!crossed[i])
+                survivors.push_back(i);
+        }
+        return survivors;
+    }
+
+    // Whether an odd candidate which came through sieveWindow is prime
+    bool isSievedPrime(const BigNumber &candidate)
+    {
+        if (candidate < (uint64_t)SIEVE_PRIME_LIMIT * SIEVE_PRIME_LIMIT)
+            return true;
+        return passesBailliePsw(candidate);
+    }
+
+    unsigned workerCount()
+    {
+        unsigned count = thread::hardware_concurrency();
+        return count ? count : 1;
+    }
+
+    // body(i) for every i in [0; count), indices are handed out to one
+    // thread per core as they finish
+    template <typename F> void parallelFor(size_t count, const F &body)
+    {
+        size_t threads = min<size_t>(workerCount(), count);
+        if (threads <= 1)
+        {
+            for (size_t i = 0; i < count; i++)
+                body(i);
+            return;
+        }
+
+        atomic<size_t> next(0);
+        vector<thread> pool;
+        for (size_t t = 0; t < threads; t++)
+        {
+            pool.emplace_back([&]() {
+                for (size_t i; (i = next++) < count;)
+                    body(i);
+            });
+        }
+        for (thread &worker : pool)
+            worker.join();
+    }
+
+    // Product of Euclid's steps [[q, 1], [1, 0]], so that (a, b) = M (u, v)
+    // for the remainders u, v reached from a, b. The entries are never
+    // negative and det is the determinant, +-1
+    struct EuclidMatrix
+    {
+        BigNumber m00 = 1, m01 = 0, m10 = 0, m11 = 1;
+        int det = 1;
+    };
+
+    EuclidMatrix product(const EuclidMatrix &x, const EuclidMatrix &y)
+    {
+        EuclidMatrix res;
+        res.m00 = x.m00 * y.m00 + x.m01 * y.m10;
+        res.m01 = x.m00 * y.m01 + x.m01 * y.m11;
+        res.m10 = x.m10 * y.m00 + x.m11 * y.m10;
+        res.m11 = x.m10 * y.m01 + x.m11 * y.m11;
+        res.det = x.det * y.det;
+        return res;
+    }
+
+    // (u, v) -> (v, u mod v) for u >= v > 0
+    void euclidStep(EuclidMatrix &m, BigNumber &u, BigNumber &v)
+    {
+        BigNumber rem;
+        BigNumber q = BigNumber::divMod(u, v, rem);
+        swap(u, v);
+        swap(v, rem);
+
+        BigNumber m00 = q * m.m00 + m.m01;
+        swap(m.m01, m.m00);
+        swap(m.m00, m00);
+        BigNumber m10 = q * m.m10 + m.m11;
+        swap(m.m11, m.m10);
+        swap(m.m10, m10);
+        m.det = -m.det;
+    }
+
+    // Digits of x from the one of 10^shift up, for x < 10^(shift + 18)
+    const uint64_t LEHMER_BASE = 1000000000000000000ULL;
+    int64_t digitsFrom(const BigNumber &x, int64_t shift)
+    {
+        return (int64_t)x.scaleByPowerOfTen(-shift).truncate(0).remainderSmall(LEHMER_BASE);
+    }
+
+    // Knuth's Algorithm L as in LimbArith::gcd: the steps are run on the
+    // leading 18 digits of u and v while their quotients are certain, then
+    // applied to u, v and m at once. Takes a division step when no quotient
+    // is certain
+    void lehmerStep(EuclidMatrix &m, BigNumber &u, BigNumber &v)
+    {
+        int64_t shift = max<int64_t>(u.orderOfMagnitude() - 18, 0);
+        int64_t uh = digitsFrom(u, shift);
+        int64_t vh = digitsFrom(v, shift);
+
+        int64_t A = 1, B = 0, C = 0, D = 1;
+        int sign = 1;
+        while (vh + C > 0 && vh + D > 0)
+        {
+            int64_t q = (uh + A) / (vh + C);
+            if (q != (uh + B) / (vh + D))
+                break;
+
+            int64_t t = A - q * C;
+            A = C;
+            C = t;
+            t = B - q * D;
+            B = D;
+            D = t;
+            t = uh - q * vh;
+            uh = vh;
+            vh = t;
+            sign = -sign;
+        }
+
+        if (B == 0)
+        {
+            euclidStep(m, u, v);
+            return;
+        }
+
+        BigNumber nextU = u * A + v * B;
+        v = u * C + v * D;
+        swap(u, nextU);
+
+        // the steps make up sign * [[D, -B], [-C, A]]
+        BigNumber m00 = (m.m00 * D - m.m01 * C) * sign;
+        m.m01 = (m.m01 * A - m.m00 * B) * sign;
+        swap(m.m00, m00);
+        BigNumber m10 = (m.m10 * D - m.m11 * C) * sign;
+        m.m11 = (m.m11 * A - m.m10 * B) * sign;
+        swap(m.m10, m10);
+        m.det *= sign;
+    }
+
+    // (u, v) = M^-1 (u, v) = det * (m11 u - m01 v, m00 v - m10 u)
+    void applyInverse(const EuclidMatrix &m, BigNumber &u, BigNumber &v)
+    {
+        BigNumber nextU = (m.m11 * u - m.m01 * v) * m.det;
+        v = (m.m00 * v - m.m10 * u) * m.det;
+        swap(u, nextU);
+    }
+
+    // Undoes the last steps of m while u > v >= 0 does not hold, which is
+    // when the quotients of the leading digits were not all those of u, v.
+    // With M = M' [[q, 1], [1, 0]], q = m00 / m01 unless that makes
+    // m10 - q m11 negative, which happens for M' = [[1, 1], [1, 0]] only
+    void backUp(EuclidMatrix &m, BigNumber &u, BigNumber &v)
+    {
+        while ((v.isNegative() || u <= v) && m.m01 != 0)
+        {
+            BigNumber rem;
+            BigNumber q = BigNumber::divMod(m.m00, m.m01, rem);
+            if (m.m10 < q * m.m11)
+                q -= 1;
+
+            BigNumber m01 = m.m00 - q * m.m01;
+            swap(m.m00, m.m01);
+            swap(m.m01, m01);
+            BigNumber m11 = m.m10 - q * m.m11;
+            swap(m.m10, m.m11);
+            swap(m.m11, m11);
+            m.det = -m.det;
+
+            BigNumber previous = q * u + v;
+            swap(v, u);
+            swap(u, previous);
+        }
+    }
+
+    // Operands from which halfGcd splits them instead of taking Lehmer steps
+    const int64_t HALF_GCD_THRESHOLD = 200;
+
+    // floor(x / 10^digits)
+    BigNumber dropDigits(const BigNumber &x, int64_t digits)
+    {
+        return x.scaleByPowerOfTen(-digits).truncate(0);
+    }
+
+    // Runs the Euclid steps on (u, v) with the top part's quotients, which
+    // are found recursively, then fixes up the remainders
+    void stepsFromTop(EuclidMatrix &m, BigNumber &u, BigNumber &v, int64_t digits);
+
+    // Steps from u > v >= 0 of n digits until v has at most n / 2 + 1,
+    // returns the matrix of the steps. Schoenhage's recursion: the quotients
+    // of the top halves of u, v are those of u, v for about half of the way,
+    // which halves u and v twice over with two recursive calls
+    EuclidMatrix halfGcd(BigNumber &u, BigNumber &v)
+    {
+        EuclidMatrix m;
+        int64_t n = u.orderOfMagnitude();
+        int64_t s = n / 2 + 1;
+
+        if (n >= HALF_GCD_THRESHOLD)
+        {
+            stepsFromTop(m, u, v, n / 2);
+            if (v.orderOfMagnitude() > s)
+            {
+                euclidStep(m, u, v);
+
+                // the top 2 (digits - s) digits bring v down to about s
+                int64_t drop = 2 * s - u.orderOfMagnitude();
+                if (drop > 0 && v.orderOfMagnitude() > s)
+                    stepsFromTop(m, u, v, drop);
+            }
+        }
+
+        // Lehmer steps may overshoot by up to 18 digits, which the top
+        // part of a larger call can not afford
+        while (v.orderOfMagnitude() > s + 18)
+            lehmerStep(m, u, v);
+        while (v.orderOfMagnitude() > s)
+            euclidStep(m, u, v);
+
+        return m;
+    }
+
+    void stepsFromTop(EuclidMatrix &m, BigNumber &u, BigNumber &v, int64_t digits)
+    {
+        BigNumber topU = dropDigits(u, digits);
+        BigNumber topV = dropDigits(v, digits);
+        EuclidMatrix top = halfGcd(topU, topV);
+
+        applyInverse(top, u, v);
+        backUp(top, u, v);
+        m = product(m, top);
+    }
+
+    // gcd(u, v) for u >= v >= 0 with the matrix of all of Euclid's steps
+    BigNumber euclid(BigNumber u, BigNumber v, EuclidMatrix &m)
+    {
+        while (v != 0)
+        {
+            if (u.orderOfMagnitude() >= HALF_GCD_THRESHOLD)
+            {
+                m = product(m, halfGcd(u, v));
+                if (v != 0)
+                    euclidStep(m, u, v);
+            }
+            else
+            {
+                lehmerStep(m, u, v);
+            }
+        }
+        return u;
+    }
+
+    // Product tree of the moduli: level 0 holds them, each level above the
+    // products of pairs, the last one the product of all
+    vector<vector<BigNumber>> productTree(const vector<BigNumber> &leaves)
+    {
+        vector<vector<BigNumber>> tree(1, leaves);
+        while (tree.back().size() > 1)
+        {
+            const vector<BigNumber> &below = tree.back();
+            vector<BigNumber> level;
+            for (size_t i = 0; i + 1 < below.size(); i += 2)
+                level.push_back(below[i] * below[i + 1]);
+            if (below.size() % 2)
+                level.push_back(below.back());
+            tree.push_back(level);
+        }
+        return tree;
+    }
+
+    // x mod m in [0; m) for m > 0
+    BigNumber nonNegativeMod(const BigNumber &x, const BigNumber &m)
+    {
+        BigNumber res = x % m;
+        if (res.isNegative())
+            res += m;
+        return res;
+    }
+
+    // Product of factors[begin; end) by a balanced tree, so that the large
+    // products have operands of about the same size. Leaves pack as many
+    // factors into a machine word as fit
+    BigNumber treeProduct(const vector<uint64_t> &factors, size_t begin, size_t end)
+    {
+        if (end - begin <= 32)
+        {
+            BigNumber res = 1;
+            uint64_t word = 1;
+            for (size_t i = begin; i < end; i++)
+            {
+                if (word > LimbArith::BASE / factors[i])
+                {
+                    res *= word;
+                    word = 1;
+                }
+                word *= factors[i];
+            }
+            return res * word;
+        }
+
+        size_t middle = begin + (end - begin) / 2;
+        return treeProduct(factors, begin, middle) * treeProduct(factors, middle, end);
+    }
+
+    // treeProduct with the subtrees below the top levels taken one per
+    // core, and the products of every level above in parallel
+    BigNumber parallelProduct(const vector<uint64_t> &factors)
+    {
+        size_t chunks = min<size_t>(4 * workerCount(), factors.size());
+        if (chunks == 0)
+            return 1;
+
+        vector<BigNumber> parts(chunks);
+        parallelFor(chunks, [&](size_t i) {
+            parts[i] = treeProduct(factors, factors.size() * i / chunks,
+                                   factors.size() * (i + 1) / chunks);
+        });
+
+        while (parts.size() > 1)
+        {
+            vector<BigNumber> merged((parts.size() + 1) / 2);
+            parallelFor(parts.size() / 2,
+                        [&](size_t i) { merged[i] = parts[2 * i] * parts[2 * i + 1]; });
+            if (parts.size() % 2)
+                swap(merged.back(), parts.back());
+            parts.swap(merged);
+        }
+        return parts[0];
+    }
+
+    // Exponent of the prime p in n!, by Legendre's formula
+    uint64_t legendreExponent(uint64_t n, uint64_t p)
+    {
+        uint64_t res = 0;
+        for (; n >= p; n /= p)
+            res += n / p;
+        return res;
+    }
+
+    // prod of primes[i]^exponents[i]. With A_j the product of the primes
+    // whose exponent has bit j set, this is prod of A_j^(2^j), which takes
+    // one squaring per bit from the top one down. The power of ten in 2^a
+    // 5^b goes to the exponent of the result
+    BigNumber primePowerProduct(const vector<uint32_t> &primes, vector<uint64_t> exponents)
+    {
+        uint64_t twos = 0, fives = 0;
+        for (size_t i = 0; i < primes.size(); i++)
+        {
+            if (primes[i] == 2)
+                twos = i + 1;
+            else if (primes[i] == 5)
+                fives = i + 1;
+        }
+        uint64_t tens = twos && fives ? min(exponents[twos - 1], exponents[fives - 1]) : 0;
+        if (tens)
+        {
+            exponents[twos - 1] -= tens;
+            exponents[fives - 1] -= tens;
+        }
+
+        uint64_t all = 0;
+        for (uint64_t e : exponents)
+            all |= e;
+
+        BigNumber res = 1;
+        for (int j = 63; j >= 0; j--)
+        {
+            res = res.square();
+            if (!((all >> j) & 1))
+                continue;
+
+            vector<uint64_t> factors;
+            for (size_t i = 0; i < primes.size(); i++)
+            {
+                if ((exponents[i] >> j) & 1)
+                    factors.push_back(primes[i]);
+            }
+            res *= parallelProduct(factors);
+        }
+
+        return res.scaleByPowerOfTen((int64_t)tens);
+    }
+
+    // Product of the integers in (m; n]
+    BigNumber rangeProduct(uint64_t m, uint64_t n)
+    {
+        vector<uint64_t> factors;
+        for (uint64_t i = m + 1; i <= n; i++)
+            factors.push_back(i);
+        return parallelProduct(factors);
+    }
+
+    // n! / m! for m <= n is taken from prime exponents once the primes up to
+    // n are few against the factors in (m; n], as a product of those below.
+    // Quotients which also cancel the factorials of other parts turn over
+    // sooner, as those take a division otherwise
+    const uint64_t FALLING_PRIME_RATIO = 16;
+    const uint64_t QUOTIENT_PRIME_RATIO = 64;
+    bool quotientByPrimes(uint64_t n, uint64_t m, uint64_t ratio)
+    {
+        return (n - m) * ratio >= n;
+    }
+
+    // n! / prod of parts[i]! for parts adding up to at most n, the factorials
+    // cancel in the exponents of the primes up to n
+    BigNumber factorialQuotient(uint32_t n, vector<uint32_t> parts)
+    {
+        // parts below p have no factor p
+        sort(parts.rbegin(), parts.rend());
+
+        vector<uint32_t> primes = sievePrimes(n + 1);
+        vector<uint64_t> exponents(primes.size());
+        for (size_t i = 0; i < primes.size(); i++)
+        {
+            exponents[i] = legendreExponent(n, primes[i]);
+            for (size_t j = 0; j < parts.size() && parts[j] >= primes[i]; j++)
+                exponents[i] -= legendreExponent(parts[j], primes[i]);
+        }
+        return primePowerProduct(primes, exponents);
+    }
+
+    // Chudnovsky's series: pi = 426880 sqrt(10005) / sum over k of
+    // (6k)! (13591409 + 545140134 k) / ((3k)! k!^3 (-640320^3)^k)
+    // Every term adds about 14.18 digits
+    const int64_t CHUDNOVSKY_DIGITS_PER_TERM = 14;
+    const uint64_t CHUDNOVSKY_C3_OVER_24 = 10939058860032000ULL; // 640320^3 / 24
+
+    // Terms [a; b) of the series by binary splitting, as exact integers: p
+    // and q are the products of the ratios between successive terms, t the
+    // sum of the terms scaled by q
+    struct SeriesPart
+    {
+        BigNumber p, q, t;
+    };
+
+    SeriesPart seriesPart(int64_t a, int64_t b)
+    {
+        SeriesPart res;
+        if (b - a == 1)
+        {
+            if (a == 0)
+            {
+                res.p = 1;
+                res.q = 1;
+            }
+            else
+            {
+                res.p = BigNumber(6 * a - 5) * (2 * a - 1) * -(6 * a - 1);
+                res.q = BigNumber(a * a) * a * CHUDNOVSKY_C3_OVER_24;
+            }
+            res.t = res.p * (13591409 + 545140134 * a);
+            return res;
+        }
+
+        int64_t middle = (a + b) / 2;
+        SeriesPart left = seriesPart(a, middle);
+        SeriesPart right = seriesPart(middle, b);
+
+        res.p = left.p * right.p;
+        res.q = left.q * right.q;
+        res.t = left.t * right.q + left.p * right.t;
+        return res;
+    }
+
+    // The first `count` terms: chunks of them are split one per core, then
+    // merged a level at a time with the four products of every merge in
+    // parallel. The p of the whole series is never needed
+    SeriesPart chudnovskySeries(int64_t count)
+    {
+        size_t chunks = (size_t)min<int64_t>(4 * workerCount(), count);
+        vector<SeriesPart> parts(chunks);
+        parallelFor(chunks, [&](size_t i) {
+            parts[i] = seriesPart(count * i / chunks, count * (i + 1) / chunks);
+        });
+
+        while (parts.size() > 1)
+        {
+            size_t pairs = parts.size() / 2;
+            bool last = parts.size() == 2;
+            vector<BigNumber> products(4 * pairs);
+            parallelFor(products.size(), [&](size_t j) {
+                const SeriesPart &left = parts[j / 4 * 2];
+                const SeriesPart &right = parts[j / 4 * 2 + 1];
+                if (j % 4 == 0 && !last)
+                    products[j] = left.p * right.p;
+                else if (j % 4 == 1)
+                    products[j] = left.q * right.q;
+                else if (j % 4 == 2)
+                    products[j] = left.t * right.q;
+                else if (j % 4 == 3)
+                    products[j] = left.p * right.t;
+            });
+
+            vector<SeriesPart> merged(pairs);
+            for (size_t i = 0; i < pairs; i++)
+            {
+                swap(merged[i].p, products[4 * i]);
+                swap(merged[i].q, products[4 * i + 1]);
+                merged[i].t = products[4 * i + 2] + products[4 * i + 3];
+            }
+            if (parts.size() % 2)
+                merged.push_back(parts.back());
+            parts.swap(merged);
+        }
+        return parts[0];
+    }
 }
 
 namespace BigNumFn
@@ -55,12 +901,13 @@ namespace BigNumFn
         }
 
         BigNumber x_i = n;
+        BigNumber nSquared = n.square();
 
         BigNumber res = x_i;
 
         for (int i = 1; i < sinIterations; i++)
         {
-            x_i = x_i * intPow(n, 2) / ((2 * i) * (2 * i + 1)) * (-1);
+            x_i = x_i * nSquared / ((2 * i) * (2 * i + 1)) * (-1);
             res += x_i;
         }
 
@@ -70,60 +917,62 @@ namespace BigNumFn
     // Calculate √x using newton's method
     BigNumber sqroot(const BigNumber &arg)
     {
-        if (arg == 0)
-            return 0;
+        return sqroot(arg, BigNumber::getPrecisionContext().precision);
+    }
 
-        BigNumber upperBound = 10;
-        BigNumber lowerBound = 0.1;
+    // Calculate √x to `digits` digits after the decimal point
+    BigNumber sqroot(const BigNumber &arg, int digits)
+    {
+        if (digits < 0)
+            throw std::invalid_argument("Precision cannot be less than zero");
 
-        BigNumber n = arg;
+        if (arg == 0)
+            return 0;
 
-        if (n < zero)
+        if (arg < zero)
         {
             throw std::invalid_argument("The argument should be non-negative");
         }
 
-        // Reduce the argument to [0.1;10]
+        // Reduce the argument to [0.1;10)
         // n = 10^2k *a
-        // sqroot(n) = 10^k * a
-        int k = 0;
-
-        while (n > upperBound)
-        {
-            n /= 100;
-            k += 1;
-        }
-        while (n < lowerBound)
-        {
-            n *= 100;
-            k -= 1;
-        }
-
-        BigNumber oneOverN = one / n;
-        BigNumber x = oneOverN / two; // Initial guess
-
-        // Newton method for initial approximation of 1/sqroot(n)
-        // f(x) = x^2-n
-        // f'(x) = 2x
-        for (int i = 0; i < 2; i++)
-        {
-            BigNumber f_x = x * x - oneOverN;
-            BigNumber fprime_x = two * x;
-
-            x = x - f_x / fprime_x; // x_(n+1) = x_n - f(x_n)/f'(x_n)
-        }
+        // sqroot(n) = 10^k * sqroot(a)
+        int64_t order = arg.orderOfMagnitude();
+        int64_t k = (order >= 0 ? order : order - 1) / 2; // floor(order / 2)
+
+        // sqroot(a) < 10 needs digits + k digits for the scaled result
+        int target = guardedPrecision(digits + k);
+        BigNumber n = BigNumber::scale(arg, -2 * k, target).truncate(target);
+
+        // Initial guess for 1/sqroot(n) from the leading digits of n,
+        // n * 10^4 is in [1000;100000) so it fits a double
+        double leading = std::stod(n.scaleByPowerOfTen(4).truncate(0).toString()) / 10000;
+        BigNumber x = 1 / std::sqrt(leading);
+
+        // The guess is good to about 3 digits and every step doubles that,
+        // so each step only works to twice the precision of the one before
+        vector<int> steps;
+        for (int p = target; p > 6; p = p / 2 + 1)
+            steps.push_back(p);
+        steps.push_back(6);
+        steps.insert(steps.begin(), target);
 
 #pragma region Newtons method
 
-        BigNumber nOverTwo = n / 2;
+        BigNumber nOverTwo = BigNumber::mul(n, 0.5, target + 1);
         BigNumber threeOverTwo = 1.5;
 
         // Then calculate the 1/sqroot(n)
         // https://en.wikipedia.org/wiki/Methods_of_computing_square_roots
         // #Iterative_methods_for_reciprocal_square_roots
-        for (int i = 0; i < sqRootIterations; i++)
+        // The last step is repeated at full precision
+        for (size_t i = steps.size(); i-- > 0;)
         {
-            x *= threeOverTwo - nOverTwo * intPow(x, 2);
+            int p = steps[i];
+            BigNumber xSquared = BigNumber::mul(x, x, p);
+            BigNumber y = BigNumber::mul(nOverTwo.truncate(p), xSquared, p);
+
+            x = BigNumber::mul(x, BigNumber::sub(threeOverTwo, y, p), p);
         }
 
 #pragma endregion
@@ -153,7 +1002,17 @@ namespace BigNumFn
 
 #pragma endregion
 
-        BigNumber finalRes = n * x * intPow(10, k);
+        BigNumber finalRes = BigNumber::scale(BigNumber::mul(n, x, target), k, digits).truncate(digits);
+
+        // The guard digits leave the result off by at most one unit in the
+        // last place, squaring exactly picks the truncated root
+        BigNumber unit = BigNumber::scale(one, -digits, digits);
+        BigNumber above = BigNumber::add(finalRes, unit, digits);
+
+        if (BigNumber::mul(above, above, 2 * digits) <= arg)
+            finalRes = above;
+        else if (BigNumber::mul(finalRes, finalRes, 2 * digits) > arg)
+            finalRes = BigNumber::sub(finalRes, unit, digits);
 
         return finalRes;
     }
@@ -168,12 +1027,14 @@ namespace BigNumFn
         // Initial guess
         BigNumber x = arg / 2;
 
+        // Only the integer part is needed, so the steps are taken to a
+        // couple of digits instead of the full precision
         for (int i = 0; i < 2; i++)
         {
-            BigNumber f_x = x * x - arg;
+            BigNumber f_x = lazy(x) * x - arg;
             BigNumber fprime_x = two * x;
 
-            x = x - f_x / fprime_x; // x_(n+1) = x_n - f(x_n)/f'(x_n)
+            x = x - BigNumber::div(f_x, fprime_x, 2); // x_(n+1) = x_n - f(x_n)/f'(x_n)
         }
 
         // get ceil of x
@@ -182,181 +1043,421 @@ namespace BigNumFn
         return x;
     }
 
+    // n! from its prime factorization, see primePowerProduct
     BigNumber factorial(int num)
     {
-
-        BigNumber res("1");
-
-        if (num > 10000 || num < 0)
+        if (num < 0)
         {
             throw logic_error("Input is out of range");
         }
 
-        for (int i = 1; i <= num; i++)
+        return factorialQuotient(num, {});
+    }
+
+    BigNumber fallingFactorial(int n, int k)
+    {
+        if (n < 0 || k < 0)
+            throw logic_error("Input is out of range");
+        if (k > n)
+            return 0;
+
+        if (quotientByPrimes(n, n - k, FALLING_PRIME_RATIO))
+            return factorialQuotient(n, {(uint32_t)(n - k)});
+        return rangeProduct(n - k, n);
+    }
+
+    BigNumber binomial(int n, int k)
+    {
+        if (n < 0)
+            throw logic_error("Input is out of range");
+        if (k < 0 || k > n)
+            return 0;
+
+        k = min(k, n - k);
+        if (quotientByPrimes(n, n - k, QUOTIENT_PRIME_RATIO))
+            return factorialQuotient(n, {(uint32_t)k, (uint32_t)(n - k)});
+
+        BigNumber rem;
+        return BigNumber::divMod(rangeProduct(n - k, n), factorial(k), rem);
+    }
+
+    // The largest part cancels against the top of n!, which leaves a
+    // product of the factors above it when the other parts are small
+    BigNumber multinomial(const vector<int> &parts)
+    {
+        int64_t n = 0;
+        uint32_t largest = 0;
+        for (int part : parts)
         {
+            if (part < 0)
+                throw logic_error("Input is out of range");
+            n += part;
+            largest = max(largest, (uint32_t)part);
+        }
+        if (n > INT32_MAX)
+            throw logic_error("Input is out of range");
+
+        if (quotientByPrimes(n, largest, QUOTIENT_PRIME_RATIO))
+            return factorialQuotient(n, vector<uint32_t>(parts.begin(), parts.end()));
 
-            res = res * i;
+        BigNumber divisor = 1;
+        bool skipped = false;
+        for (int part : parts)
+        {
+            if ((uint32_t)part == largest && !skipped)
+                skipped = true;
+            else
+                divisor *= factorial(part);
         }
 
-        return res;
+        BigNumber rem;
+        return BigNumber::divMod(rangeProduct(largest, n), divisor, rem);
     }
 
     BigNumber ln(const BigNumber &n)
     {
+        return ln(n, BigNumber::getPrecisionContext().precision);
+    }
+
+    // Calculate ln(x) to `digits` digits after the decimal point
+    BigNumber ln(const BigNumber &n, int digits)
+    {
+        if (digits < 0)
+            throw invalid_argument("Precision cannot be less than zero");
 
         if (n <= 0)
             throw invalid_argument("Argument should be positive");
 
-        // use fact ln(2^p * g) = p * ln(2) + ln(g)
-        // find p
+        // use fact ln(10^q * 2^p * g) = q * ln(10) + p * ln(2) + ln(g)
+        // q just moves the exponent, which leaves at most 3 halvings for p
+        int64_t q = n.orderOfMagnitude() - 1;
+        string qStr = std::to_string(q);
 
-        BigNumber p = 0;
-        BigNumber g = n;
+        // q * ln(10) multiplies the error of ln(10) by q
+        int precision = guardedPrecision((int64_t)digits + (int64_t)qStr.size());
+
+        int p = 0;
+        BigNumber g = BigNumber::scale(n, -q, precision).truncate(precision);
         while (g >= 2)
         {
             p += 1;
-            g /= 2;
+            g = BigNumber::div(g, two, precision);
         }
         while (g < 1)
         {
             p -= 1;
-            g *= 2;
+            g = BigNumber::mul(g, two, precision);
         }
 
         // https://math.stackexchange.com/questions/4519431/taylor-series-convergence-for-logx/4519474#4519474
-        BigNumber x_i;
-        BigNumber res = 0;
+        BigNumber gMinusOneOverGPlusOne = BigNumber::div(
+            BigNumber::sub(g, one, precision), BigNumber::add(g, one, precision), precision);
+        BigNumber res = lnSeries(gMinusOneOverGPlusOne, precision);
 
-        BigNumber gMinusOneOverGPlusOne = (g - 1) / (g + 1);
+        res = BigNumber::add(res, BigNumber::mul(BigNumber(qStr), ln10To(precision), precision),
+                             precision);
+        res = BigNumber::add(res, BigNumber::mul(p, ln2To(precision), precision), precision);
 
-        for (int i = 0; i < lnIterations; i++)
-        {
+        return res.truncate(digits);
+    }
 
-            x_i = one / (2 * i + 1);
-            x_i *= intPow(gMinusOneOverGPlusOne, 2 * i + 1);
-            res += x_i;
-        }
+    // Square-and-multiply from the top bit of |exponent|, a negative
+    // exponent takes a single division at the end. With the base m * 10^e,
+    // a mantissa of 1 only moves the exponent, and as 2^-k = 5^k * 10^-k and
+    // 5^-k = 2^k * 10^-k, a mantissa of 2 or 5 needs no division
+    BigNumber intPow(const BigNumber &base, int64_t exponent)
+    {
+        if (exponent == INT64_MIN)
+            throw logic_error("Input is out of range");
 
-        res *= 2;
+        uint64_t magnitude = exponent < 0 ? -exponent : exponent;
+        bool negative = base.isNegative() && magnitude % 2 == 1;
+        uint64_t mantissa = base._limbs.size() == 1 ? base._limbs[0] : 0;
 
-        return p * ln2 + res;
-    }
+        if (mantissa == 1 || (exponent < 0 && (mantissa == 2 || mantissa == 5)))
+        {
+            // the power of ten is (e + 1) * exponent for a mantissa of 2 or 5
+            int64_t e = mantissa == 1 ? base._exponent : base._exponent + 1;
+            if (e != 0 && (magnitude > (uint64_t)INT64_MAX / (e < 0 ? -(uint64_t)e : e)))
+                throw logic_error("Input is out of range");
+
+            BigNumber res = mantissa == 1 ? one : intPow(mantissa == 2 ? 5 : 2, magnitude);
+            res = res.scaleByPowerOfTen(e * exponent);
+            return negative ? -res : res;
+        }
 
-    BigNumber intPow(const BigNumber &base, int exponent)
-    {
         BigNumber res = one;
-        for (int i = 0; i < std::abs(exponent); i++)
+        for (int bit = magnitude ? 63 - __builtin_clzll(magnitude) : -1; bit >= 0; bit--)
         {
-            res *= base;
+            res = res.square();
+            if ((magnitude >> bit) & 1)
+                res *= base;
         }
 
         return exponent < 0 ? one / res : res;
     }
 
+    // Baillie-PSW: trial division by the small primes, then a strong
+    // probable prime test to base 2 and a strong Lucas test. No composite
+    // is known to pass both, none exists below 2^64
     bool isPrime(const BigNumber &n)
     {
-        if (n <= one || !n.isInt())
+        if (!n.isInt() || n <= one)
             return false;
 
-        if (n == 2 || n == 3)
-        {
-            return true;
-        }
-
-        if (n % 2 == 0 || n % 3 == 0)
-        {
+        if (hasSmallFactor(n))
             return false;
-        }
-
-        BigNumber upperBound = ceilSqroot(n);
+        if (n < (uint64_t)SMALL_PRIME_LIMIT * SMALL_PRIME_LIMIT)
+            return true;
 
-        for (BigNumber i = 5; i < upperBound; i += 6)
-        {
-            if (n % i == zero || n % (i + 2) == zero)
-                return false;
-        }
-        return true;
+        return passesBailliePsw(n);
     }
 
     BigNumber modPower(BigNumber a, BigNumber exponent, const BigNumber &p)
     {
-        BigNumber res = 1;
         a = a % p;
 
         if (a == 0)
             return 0;
+        if (exponent <= 0)
+            return 1;
 
-        while (exponent > 0)
-        {
-            if (exponent.isOdd())
-                res = (res * a) % p;
+        BigNumber res = ModContext(p).pow(a, exponent);
+
+        // the result keeps the sign of a^exponent, as operator% does
+        if (a.isNegative() && exponent.isOdd() && res != 0)
+            res -= p.abs();
 
-            exponent = (exponent / 2).truncate(0);
-            a = (a * a) % p;
-        }
         return res;
     }
 
+    // gcd(|a|, |b|) without recursion, see LimbArith::gcd. The common
+    // power of ten is taken out first, gcd(a, 0) = |a|
     BigNumber gcd(const BigNumber &a, const BigNumber &b)
     {
-        if (a < b)
-            return gcd(b, a);
-        else if (a % b == 0)
-            return b;
-        else
-            return gcd(b, a % b);
+        if (!a.isInt() || !b.isInt())
+            throw invalid_argument("gcd requires integer operands");
+
+        int64_t exponent = min(a._exponent, b._exponent);
+        BigNumber x = a;
+        BigNumber y = b;
+        x.shiftMantissaLeft(a._exponent - exponent);
+        y.shiftMantissaLeft(b._exponent - exponent);
+
+        BigNumber res;
+        res._limbs.resize(max(x._limbs.size(), y._limbs.size()));
+        res._limbs.resize(LimbArith::gcd(res._limbs.data(), x._limbs.data(), x._limbs.size(),
+                                         y._limbs.data(), y._limbs.size()));
+        res._exponent = exponent;
+        res.removeTrailingZeroes();
+
+        return res;
     }
 
-    bool isPrimeFerma(const BigNumber &n, int k)
+    // The cofactors come from the matrix M of Euclid's steps, with
+    // (|a|, |b|) = M (g, 0) the first row of M^-1 gives g = x |a| + y |b|
+    BigNumber extendedGcd(const BigNumber &a, const BigNumber &b, BigNumber &x, BigNumber &y)
     {
-        if (n <= 1 || n == 4)
-            return false;
-        if (n <= 3)
-            return true;
+        if (!a.isInt() || !b.isInt())
+            throw invalid_argument("extendedGcd requires integer operands");
 
-        while (k > 0)
+        if (a == 0 && b == 0)
         {
+            x = zero;
+            y = zero;
+            return 0;
+        }
 
-            BigNumber a = BigNumber(2) + BigNumber(rand()) % (n - 4);
+        BigNumber u = a.abs();
+        BigNumber v = b.abs();
+        bool swapped = u < v;
+        if (swapped)
+            swap(u, v);
 
-            if (gcd(n, a) != 1)
-                return false;
+        EuclidMatrix m;
+        BigNumber res = euclid(u, v, m);
 
-            if (modPower(a, n - 1, n) != 1)
-                return false;
+        x = m.m11 * m.det;
+        y = m.m01 * -m.det;
+        if (swapped)
+            swap(x, y);
+        if (a.isNegative())
+            x = -x;
+        if (b.isNegative())
+            y = -y;
+
+        return res;
+    }
+
+    BigNumber modInverse(const BigNumber &a, const BigNumber &m)
+    {
+        if (m == 0)
+            throw invalid_argument("Modulus by zero");
+
+        BigNumber modulus = m.abs();
+        BigNumber x, y;
+        if (extendedGcd(nonNegativeMod(a, modulus), modulus, x, y) != 1)
+            throw invalid_argument("The number is not invertible modulo m");
+
+        return nonNegativeMod(x, modulus);
+    }
 
-            k--;
+    // With P the product of the moduli, x = sum of r_i (P / m_i)^-1 P / m_i
+    // mod P. P / m_i mod m_i comes from P mod m_i^2, taken down a remainder
+    // tree over the product tree of the moduli, the sum is taken up the
+    // product tree as x_left P_right + x_right P_left
+    BigNumber crt(const vector<BigNumber> &residues, const vector<BigNumber> &moduli)
+    {
+        if (residues.size() != moduli.size())
+            throw invalid_argument("Every residue requires its modulus");
+        if (moduli.empty())
+            return 0;
+
+        vector<BigNumber> leaves;
+        for (const BigNumber &m : moduli)
+        {
+            if (!m.isInt() || m == 0)
+                throw invalid_argument("Moduli should be non-zero integers");
+            leaves.push_back(m.abs());
+        }
+        vector<vector<BigNumber>> tree = productTree(leaves);
+
+        vector<BigNumber> rem = tree.back();
+        for (size_t level = tree.size() - 1; level-- > 0;)
+        {
+            vector<BigNumber> below(tree[level].size());
+            for (size_t i = 0; i < below.size(); i++)
+                below[i] = rem[i / 2] % tree[level][i].square();
+            rem.swap(below);
+        }
+
+        vector<BigNumber> values(leaves.size());
+        for (size_t i = 0; i < leaves.size(); i++)
+        {
+            BigNumber unused;
+            BigNumber cofactor = BigNumber::divMod(rem[i], leaves[i], unused);
+
+            BigNumber inverse, y;
+            if (extendedGcd(cofactor, leaves[i], inverse, y) != 1)
+                throw invalid_argument("Moduli should be pairwise coprime");
+            values[i] = nonNegativeMod(nonNegativeMod(residues[i], leaves[i]) * inverse, leaves[i]);
+        }
+
+        for (size_t level = 0; level + 1 < tree.size(); level++)
+        {
+            vector<BigNumber> above;
+            for (size_t i = 0; i + 1 < values.size(); i += 2)
+                above.push_back(values[i] * tree[level][i + 1] + values[i + 1] * tree[level][i]);
+            if (values.size() % 2)
+                above.push_back(values.back());
+            values.swap(above);
         }
 
+        return nonNegativeMod(values[0], tree.back()[0]);
+    }
+
+    bool isPrimeFerma(const BigNumber &n, int k)
+    {
+        if (!n.isInt() || n <= one)
+            return false;
+
+        if (hasSmallFactor(n))
+            return false;
+        if (n < (uint64_t)SMALL_PRIME_LIMIT * SMALL_PRIME_LIMIT)
+            return true;
+
+        ModContext mod(n);
+        for (int i = 0; i < k && i < (int)smallPrimes.size(); i++)
+        {
+            if (!isStrongProbablePrime(n, mod, smallPrimes[i]))
+                return false;
+        }
         return true;
     }
 
+    // Windows of a few average prime gaps are sieved in turn, their
+    // survivors tested one per core at a time
     BigNumber nextPrime(const BigNumber &n)
     {
 
         if (n < two)
             return two;
 
-        BigNumber begin = n.truncate(0) + 1;
+        BigNumber base = n.truncate(0) + 1;
+        if (!base.isOdd())
+            base += 1;
 
-        bool foundPrime = false;
+        // the gap near n averages ln(n), about 2.3 per digit
+        size_t count = 64 + 4 * (size_t)n.orderOfMagnitude();
+        size_t batch = workerCount();
 
-        while (!foundPrime)
+        for (;; base += 2 * (uint64_t)count)
         {
+            vector<size_t> survivors = sieveWindow(base, count);
 
-            // If fermat's algorithm gives positive result
-            // Then it is likely that number is prime
-            // And we check it
-            foundPrime = isPrimeFerma(begin);
+            for (size_t first = 0; first < survivors.size(); first += batch)
+            {
+                size_t size = min(batch, survivors.size() - first);
+                vector<char> prime(size);
+                parallelFor(size, [&](size_t j) {
+                    prime[j] = isSievedPrime(base + 2 * (uint64_t)survivors[first + j]);
+                });
 
-            if (foundPrime && isPrime(begin))
-                break;
+                for (size_t j = 0; j < size; j++)
+                {
+                    if (prime[j])
+                        return base + 2 * (uint64_t)survivors[first + j];
+                }
+            }
+        }
+    }
 
-            foundPrime = false;
-            begin += 1;
+    // Odd candidates are sieved a window at a time, windows in parallel
+    vector<BigNumber> primesInRange(const BigNumber &lo, const BigNumber &hi)
+    {
+        vector<BigNumber> res;
+
+        BigNumber first = lo.isInt() ? lo : lo.truncate(0) + 1;
+        BigNumber last = hi.truncate(0);
+        if (first < two)
+            first = two;
+        if (first > last)
+            return res;
+
+        if (first == two)
+        {
+            res.push_back(two);
+            first = 3;
         }
+        if (!first.isOdd())
+            first += 1;
+        if (first > last)
+            return res;
+
+        // candidates first + 2i for i < count
+        BigNumber halfSpan = ((last - first) / 2).truncate(0);
+        if (halfSpan >= UINT64_MAX)
+            throw invalid_argument("The range is too large");
+        uint64_t count = halfSpan.remainderSmall(UINT64_MAX) + 1;
+
+        size_t windows = (size_t)((count + SIEVE_WINDOW - 1) / SIEVE_WINDOW);
+        vector<vector<BigNumber>> found(windows);
 
-        return begin;
+        parallelFor(windows, [&](size_t w) {
+            uint64_t offset = (uint64_t)w * SIEVE_WINDOW;
+            BigNumber base = first + 2 * offset;
+
+            for (size_t i : sieveWindow(base, (size_t)min<uint64_t>(SIEVE_WINDOW, count - offset)))
+            {
+                BigNumber candidate = base + 2 * (uint64_t)i;
+                if (isSievedPrime(candidate))
+                    found[w].push_back(candidate);
+            }
+        });
+
+        for (vector<BigNumber> &primes : found)
+            res.insert(res.end(), primes.begin(), primes.end());
+        return res;
     }
 
     int find(const BigNumber arr[], int size, const BigNumber &target)
@@ -398,35 +1499,15 @@ namespace BigNumFn
         return sum / BigNumber(size);
     }
 
+    // pi = 426880 sqrt(10005) q / t for the series summed by binary
+    // splitting, with a single division at the end
     BigNumber chudnovskyPI(int n)
     {
+        int precision = guardedPrecision(n);
+        SeriesPart series = chudnovskySeries(max(n, 0) / CHUDNOVSKY_DIGITS_PER_TERM + 2);
 
-        BigNumber a_k = one;
-        BigNumber a_sum = one;
-        BigNumber b_sum = zero;
-        BigNumber C = 640320;
-
-        BigNumber SQROOT_10005 =
-            string("100."
-                   "02499687578100594479218787635777800159502436869631465713551156965096785"
-                   "38643042923111879484999732977551938893695661811101310349073901991031130"
-                   "110817620021084773209484713755522300964025814877362598");
-
-        BigNumber C3_OVER_24 = intPow(C, 3) / 24;
-        BigNumber C3_OVER_24_INV = BigNumber(1.0) / C3_OVER_24;
-
-        for (int i = 1; i < n; i++)
-        {
-            a_k *= -(6 * i - 5) * (2 * i - 1) * (6 * i - 1);
-            a_k /= intPow(i, 3);
-            a_k *= C3_OVER_24_INV;
-
-            a_sum += a_k;
-            b_sum += a_k * i;
-        }
-
-        BigNumber total = a_sum * 13591409 + b_sum * 545140134;
-        BigNumber pi = SQROOT_10005 * 426880 / total;
+        BigNumber ratio = BigNumber::div(series.q * 426880, series.t, precision);
+        BigNumber pi = BigNumber::mul(ratio, sqroot(10005, precision), precision);
 
         return pi.round(n);
     }
@@ -1,20 +1,39 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 class BigNumber;
 
 namespace BigNumFn
 {
     BigNumber sin(const BigNumber &n);
     BigNumber sqroot(const BigNumber &n);
+    BigNumber sqroot(const BigNumber &n, int digits);
     BigNumber ceilSqroot(const BigNumber &arg);
     BigNumber factorial(int num);
+    // n! / (n - k)!, the product of the k integers from n down
+    BigNumber fallingFactorial(int n, int k);
+    // n! / (k! (n - k)!), zero for k outside [0; n]
+    BigNumber binomial(int n, int k);
+    // (k_1 + ... + k_m)! / (k_1! ... k_m!)
+    BigNumber multinomial(const std::vector<int> &parts);
     BigNumber ln(const BigNumber &n);
-    BigNumber intPow(const BigNumber &base, int exponent);
+    BigNumber ln(const BigNumber &n, int digits);
+    BigNumber intPow(const BigNumber &base, int64_t exponent);
     BigNumber modPower(BigNumber a, BigNumber exponent, const BigNumber &p);
     BigNumber gcd(const BigNumber &a, const BigNumber &b);
+    // g = gcd(a, b) = x * a + y * b
+    BigNumber extendedGcd(const BigNumber &a, const BigNumber &b, BigNumber &x, BigNumber &y);
+    // x in [0; |m|) with a * x = 1 mod m
+    BigNumber modInverse(const BigNumber &a, const BigNumber &m);
+    // x in [0; m_1 * ... * m_k) with x = r_i mod m_i for pairwise coprime m_i
+    BigNumber crt(const std::vector<BigNumber> &residues, const std::vector<BigNumber> &moduli);
     bool isPrimeFerma(const BigNumber &n, int k = 1);
     bool isPrime(const BigNumber &n);
     BigNumber nextPrime(const BigNumber &n);
+    // Primes p with lo <= p <= hi in increasing order
+    std::vector<BigNumber> primesInRange(const BigNumber &lo, const BigNumber &hi);
     int find(const BigNumber arr[], int size, const BigNumber &target);
     void bubbleSort(BigNumber arr[], int size);
     BigNumber getAverage(const BigNumber arr[], int size);
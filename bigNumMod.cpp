@@ -0,0 +1,369 @@
+#include "bigNumMod.h"
+#include "limbArith.h"
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+namespace
+{
+    size_t trimmedSize(const uint64_t *a, size_t n)
+    {
+        while (n > 0 && a[n - 1] == 0)
+            n--;
+        return n;
+    }
+
+    size_t bitLength(const vector<uint32_t> &words)
+    {
+        if (words.empty())
+            return 0;
+
+        size_t bits = 32 * words.size();
+        for (uint32_t top = words.back(); !(top >> 31); top <<= 1)
+            bits--;
+        return bits;
+    }
+
+    // Bits [low; low + count) of the exponent, count <= 32
+    uint32_t bitsAt(const vector<uint32_t> &words, size_t low, int count)
+    {
+        uint32_t res = 0;
+        for (int i = count; i-- > 0;)
+        {
+            size_t bit = low + i;
+            res = res << 1 | (bit / 32 < words.size() ? (words[bit / 32] >> (bit % 32)) & 1 : 0);
+        }
+        return res;
+    }
+
+    // Sliding window width: 2^(k - 1) odd powers are precomputed and about
+    // bits / (k + 1) multiplications are left
+    int slidingWindowSize(size_t bits)
+    {
+        int k = 1;
+        while (k < 8 && (1u << (k - 1)) + bits / (k + 1) > (1u << k) + bits / (k + 2))
+            k++;
+        return k;
+    }
+
+    // Digit width for Yao's method, which costs bits / k + 2^k multiplications
+    int fixedBaseDigitSize(size_t bits)
+    {
+        int k = 1;
+        while (k < 16 && bits / k + (1u << k) > bits / (k + 1) + (1u << (k + 1)))
+            k++;
+        return k;
+    }
+}
+
+namespace BigNumFn
+{
+    ModContext::ModContext(const BigNumber &modulus) : _modulus(modulus.abs())
+    {
+        _m = integerLimbs(modulus);
+        if (_m.empty())
+            throw invalid_argument("Modulus by zero");
+
+        size_t n = _m.size();
+        Residue power(2 * n + 1, 0);
+        Residue rem(n);
+        power[2 * n] = 1;
+
+        _mu.resize(n + 2);
+        LimbArith::div(_mu.data(), rem.data(), power.data(), power.size(), _m.data(), n);
+        _mu.resize(trimmedSize(_mu.data(), _mu.size()));
+    }
+
+    ModContext::Residue ModContext::integerLimbs(const BigNumber &x)
+    {
+        if (!x.isInt())
+            throw invalid_argument("Modulus requires integer operands");
+
+        LimbBuffer shifted = x._limbs;
+        size_t wholeLimbs = x._exponent / LimbArith::BASE_DIGITS;
+        int rest = x._exponent % LimbArith::BASE_DIGITS;
+
+        if (rest && !shifted.empty())
+        {
+            uint64_t carry = LimbArith::mulSmall(shifted.data(), shifted.data(), shifted.size(),
+                                                 LimbArith::POW10[rest]);
+            if (carry)
+                shifted.push_back(carry);
+        }
+
+        Residue res(shifted.empty() ? 0 : wholeLimbs, 0);
+        res.insert(res.end(), shifted.data(), shifted.data() + shifted.size());
+        return res;
+    }
+
+    const BigNumber &ModContext::modulus() const
+    {
+        return _modulus;
+    }
+
+    // q = floor(floor(x / BASE^(n - 1)) * mu / BASE^(n + 1)) is at most two
+    // less than x / m, so x - q * m is brought below m by two subtractions
+    void ModContext::reduceInPlace(Residue &x) const
+    {
+        size_t n = _m.size();
+        size_t nx = trimmedSize(x.data(), x.size());
+
+        if (nx >= n)
+        {
+            size_t nTop = nx - (n - 1);
+            Residue estimate(nTop + _mu.size());
+            LimbArith::mul(estimate.data(), x.data() + n - 1, nTop, _mu.data(), _mu.size());
+
+            size_t ne = trimmedSize(estimate.data(), estimate.size());
+            if (ne > n + 1)
+            {
+                size_t nq = ne - (n + 1);
+                Residue product(nq + n);
+                LimbArith::mul(product.data(), estimate.data() + n + 1, nq, _m.data(), n);
+
+                LimbArith::sub(x.data(), x.data(), nx, product.data(),
+                               trimmedSize(product.data(), product.size()));
+                nx = trimmedSize(x.data(), nx);
+            }
+
+            while (LimbArith::compare(x.data(), nx, _m.data(), n) >= 0)
+            {
+                LimbArith::sub(x.data(), x.data(), nx, _m.data(), n);
+                nx = trimmedSize(x.data(), nx);
+            }
+        }
+
+        x.resize(n);
+    }
+
+    void ModContext::mulInPlace(Residue &r, const Residue &a, const Residue &b) const
+    {
+        size_t na = trimmedSize(a.data(), a.size());
+        size_t nb = trimmedSize(b.data(), b.size());
+
+        r.assign(2 * _m.size(), 0);
+        if (na == 0 || nb == 0)
+        {
+            r.resize(_m.size());
+            return;
+        }
+
+        // the same array twice takes the squaring kernel
+        if (&a == &b)
+            LimbArith::sqr(r.data(), a.data(), na);
+        else
+            LimbArith::mul(r.data(), a.data(), na, b.data(), nb);
+
+        reduceInPlace(r);
+    }
+
+    ModContext::Residue ModContext::toResidue(const BigNumber &x) const
+    {
+        size_t n = _m.size();
+        Residue res = integerLimbs(x);
+
+        if (res.size() > 2 * n)
+        {
+            Residue quotient(res.size() - n + 1);
+            Residue rem(n);
+            LimbArith::div(quotient.data(), rem.data(), res.data(), res.size(), _m.data(), n);
+            res = rem;
+        }
+        else
+        {
+            res.resize(2 * n, 0);
+            reduceInPlace(res);
+        }
+
+        // -x mod m = m - (x mod m)
+        if (x.isNegative() && trimmedSize(res.data(), n) > 0)
+            LimbArith::sub(res.data(), _m.data(), n, res.data(), n);
+
+        return res;
+    }
+
+    BigNumber ModContext::fromResidue(const Residue &x)
+    {
+        BigNumber res;
+        res._limbs.assign(x.data(), x.data() + x.size());
+        res.removeLeadingZeroes();
+        res.removeTrailingZeroes();
+        return res;
+    }
+
+    BigNumber ModContext::reduce(const BigNumber &x) const
+    {
+        return fromResidue(toResidue(x));
+    }
+
+    BigNumber ModContext::mul(const BigNumber &a, const BigNumber &b) const
+    {
+        Residue res;
+        mulInPlace(res, toResidue(a), toResidue(b));
+        return fromResidue(res);
+    }
+
+    BigNumber ModContext::square(const BigNumber &a) const
+    {
+        Residue res;
+        Residue x = toResidue(a);
+        mulInPlace(res, x, x);
+        return fromResidue(res);
+    }
+
+    ModContext::ExponentBits ModContext::exponentBits(const BigNumber &exponent)
+    {
+        if (!exponent.isInt() || exponent.isNegative())
+            throw invalid_argument("Exponent should be a non-negative integer");
+
+        // peeled off 32 bits at a time by single limb divisions
+        Residue e = integerLimbs(exponent);
+        ExponentBits words;
+        for (size_t ne = e.size(); ne > 0; ne = trimmedSize(e.data(), ne))
+            words.push_back((uint32_t)LimbArith::divSmall(e.data(), e.data(), ne, 1ULL << 32));
+
+        while (!words.empty() && words.back() == 0)
+            words.pop_back();
+        return words;
+    }
+
+    // Sliding window from the top bit: runs of zeroes cost one squaring per
+    // bit, every window of at most k bits ending in a one costs its squarings
+    // and a single multiplication by a precomputed odd power
+    BigNumber ModContext::pow(const BigNumber &base, const BigNumber &exponent) const
+    {
+        ExponentBits words = exponentBits(exponent);
+        size_t bits = bitLength(words);
+        if (bits == 0)
+            return fromResidue(toResidue(BigNumber(1)));
+
+        int k = slidingWindowSize(bits);
+
+        // odd[i] = base^(2i + 1)
+        vector<Residue> odd(1u << (k - 1));
+        odd[0] = toResidue(base);
+        if (k > 1)
+        {
+            Residue baseSquared;
+            mulInPlace(baseSquared, odd[0], odd[0]);
+            for (size_t i = 1; i < odd.size(); i++)
+                mulInPlace(odd[i], odd[i - 1], baseSquared);
+        }
+
+        Residue res;
+        Residue next;
+        bool started = false;
+
+        for (size_t i = bits; i-- > 0;)
+        {
+            if (!bitsAt(words, i, 1))
+            {
+                mulInPlace(next, res, res);
+                res.swap(next);
+                continue;
+            }
+
+            // the longest window [low; i] of at most k bits ending in a one
+            size_t low = i + 1 >= (size_t)k ? i + 1 - k : 0;
+            while (!bitsAt(words, low, 1))
+                low++;
+
+            int width = (int)(i - low + 1);
+            uint32_t window = bitsAt(words, low, width);
+
+            if (started)
+            {
+                for (int j = 0; j < width; j++)
+                {
+                    mulInPlace(next, res, res);
+                    res.swap(next);
+                }
+                mulInPlace(next, res, odd[window >> 1]);
+                res.swap(next);
+            }
+            else
+            {
+                res = odd[window >> 1];
+                started = true;
+            }
+            i = low;
+        }
+
+        return fromResidue(res);
+    }
+
+    FixedBasePower::FixedBasePower(const ModContext &context, const BigNumber &base,
+                                   size_t exponentBits)
+        : _context(context), _base(base)
+    {
+        if (exponentBits == 0)
+            exponentBits = bitLength(ModContext::exponentBits(context.modulus()));
+
+        _digitBits = fixedBaseDigitSize(exponentBits);
+        size_t digits = (exponentBits + _digitBits - 1) / _digitBits;
+
+        // powers[j] = base^(2^(k * j)), each from the last by k squarings
+        _powers.resize(digits);
+        _powers[0] = _context.toResidue(base);
+
+        ModContext::Residue next;
+        for (size_t j = 1; j < digits; j++)
+        {
+            _powers[j] = _powers[j - 1];
+            for (int i = 0; i < _digitBits; i++)
+            {
+                _context.mulInPlace(next, _powers[j], _powers[j]);
+                _powers[j].swap(next);
+            }
+        }
+    }
+
+    // With digits e_j, base^e = prod over d of (prod over e_j >= d of
+    // powers[j]), accumulated from the largest digit down
+    BigNumber FixedBasePower::pow(const BigNumber &exponent) const
+    {
+        ModContext::ExponentBits words = ModContext::exponentBits(exponent);
+        size_t bits = bitLength(words);
+        if (bits > _powers.size() * _digitBits)
+            return _context.pow(_base, exponent);
+
+        // digit positions from the largest digit down
+        vector<pair<uint32_t, size_t>> digits;
+        for (size_t j = 0; j < _powers.size(); j++)
+        {
+            uint32_t d = bitsAt(words, j * _digitBits, _digitBits);
+            if (d)
+                digits.push_back(make_pair(d, j));
+        }
+        sort(digits.rbegin(), digits.rend());
+
+        ModContext::Residue res = _context.toResidue(BigNumber(1));
+        ModContext::Residue partial;
+        ModContext::Residue next;
+        size_t taken = 0;
+
+        for (uint32_t d = digits.empty() ? 0 : digits[0].first; d >= 1; d--)
+        {
+            for (; taken < digits.size() && digits[taken].first == d; taken++)
+            {
+                if (taken > 0)
+                {
+                    _context.mulInPlace(next, partial, _powers[digits[taken].second]);
+                    partial.swap(next);
+                }
+                else
+                {
+                    partial = _powers[digits[taken].second];
+                }
+            }
+
+            _context.mulInPlace(next, res, partial);
+            res.swap(next);
+        }
+
+        return ModContext::fromResidue(res);
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "bigNumber.h"
+#include <cstdint>
+#include <vector>
+
+namespace BigNumFn
+{
+    // Arithmetic modulo a fixed integer, for many multiplications by the
+    // same modulus as in modPower
+    //
+    // Residues are reduced by Barrett's method: mu = BASE^(2n) / m is found
+    // once for an n limb modulus, after which a remainder costs two
+    // multiplications instead of a division. Results are in [0; |m|).
+    //
+    // A context is immutable and can be shared between threads.
+    class ModContext
+    {
+    public:
+        // Throws for a zero or non-integer modulus, the sign is ignored
+        explicit ModContext(const BigNumber &modulus);
+
+        const BigNumber &modulus() const;
+
+        // x mod |m| for any integer x
+        BigNumber reduce(const BigNumber &x) const;
+
+        BigNumber mul(const BigNumber &a, const BigNumber &b) const;
+        BigNumber square(const BigNumber &a) const;
+
+        // base^exponent mod |m| for an integer exponent >= 0
+        BigNumber pow(const BigNumber &base, const BigNumber &exponent) const;
+
+    private:
+        typedef std::vector<uint64_t> Residue;
+        typedef std::vector<uint32_t> ExponentBits;
+
+        BigNumber _modulus;
+        Residue _m;
+        Residue _mu;
+
+        // x mod m, x has to be below BASE^(2n), leaves n limbs in x
+        void reduceInPlace(Residue &x) const;
+
+        // r = a * b mod m for residues of n limbs
+        void mulInPlace(Residue &r, const Residue &a, const Residue &b) const;
+
+        // Limbs of |x| for an integer x, with the exponent multiplied out
+        static Residue integerLimbs(const BigNumber &x);
+
+        Residue toResidue(const BigNumber &x) const;
+        static BigNumber fromResidue(const Residue &x);
+
+        // Binary digits of an integer exponent >= 0 in 32 bit words, least
+        // significant first, with no zero words on top
+        static ExponentBits exponentBits(const BigNumber &exponent);
+
+        friend class FixedBasePower;
+    };
+
+    // Powers of one base modulo a fixed modulus for many exponents
+    //
+    // base^(2^(k * j)) is stored for every k bit digit j of the exponent, so
+    // that a power takes no squarings and about bits / k + 2^k
+    // multiplications (Yao's method)
+    class FixedBasePower
+    {
+    public:
+        // Covers exponents of up to `exponentBits` bits, by default as many
+        // as the modulus has, longer ones take ModContext::pow
+        FixedBasePower(const ModContext &context, const BigNumber &base, size_t exponentBits = 0);
+
+        BigNumber pow(const BigNumber &exponent) const;
+
+    private:
+        ModContext _context;
+        BigNumber _base;
+        int _digitBits;
+        std::vector<ModContext::Residue> _powers;
+    };
+}
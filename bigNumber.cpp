@@ -1,8 +1,8 @@
-
 #include "bigNumber.h"
+#include "limbArith.h"
 #include <algorithm>
 #include <array>
-#include <assert.h>
+#include <atomic>
 #include <cstdint>
 #include <cstring>
 #include <exception>
@@ -12,6 +12,7 @@
 #include <string>
 
 using namespace std;
+using namespace LimbArith;
 
 // ----------------------------------
 // Static initialization
@@ -21,8 +22,14 @@ const BigNumber BigNumber::_one("1");
 const BigNumber BigNumber::_two("2");
 const BigNumber BigNumber::_ten("10");
 
-int BigNumber::_precision = 110;
-int BigNumber::_printPrecision = 99;
+namespace
+{
+    // Used by threads outside of any PrecisionScope
+    std::atomic<BigNumber::PrecisionContext> defaultContext(BigNumber::PrecisionContext{110, 99});
+
+    // Innermost scope of the calling thread
+    thread_local BigNumber::PrecisionScope *currentScope = nullptr;
+}
 
 // ----------------------------------
 
@@ -31,592 +38,480 @@ BigNumber::BigNumber()
 {
 }
 
+// Moves zeroes at the end of the mantissa into the exponent
 void BigNumber::removeTrailingZeroes()
 {
-    int zeroesEndIndex = _digits.find_last_not_of('0', _digits.size() - 1);
-
-    if (zeroesEndIndex < _decimalPoint || zeroesEndIndex == string::npos)
+    if (_limbs.empty())
     {
-        zeroesEndIndex = _decimalPoint;
+        _exponent = 0;
+        return;
     }
-    _digits.erase(zeroesEndIndex + 1);
+
+    size_t zeroLimbs = 0;
+
+    while (_limbs[zeroLimbs] == 0)
+        zeroLimbs++;
+
+    int64_t zeroes = (int64_t)zeroLimbs * BASE_DIGITS + trailingZeroes(_limbs[zeroLimbs]);
+
+    shiftMantissaRight(zeroes);
+    _exponent += zeroes;
 }
 
+// Removes zero limbs at the top of the magnitude
 void BigNumber::removeLeadingZeroes()
 {
-    int zeroesEndIndex = _digits.find_first_not_of('0', 0);
+    while (!_limbs.empty() && _limbs.back() == 0)
+        _limbs.pop_back();
 
-    if (zeroesEndIndex > _decimalPoint - 1 || zeroesEndIndex == string::npos)
+    if (_limbs.empty())
     {
-        zeroesEndIndex = _decimalPoint - 1;
+        _exponent = 0;
+        _isNegative = false;
     }
-
-    _digits.erase(0, zeroesEndIndex);
-    _decimalPoint -= zeroesEndIndex;
 }
 
-// returns |this|<|other|
-bool BigNumber::compareAbsValue(const BigNumber &other) const
+int64_t BigNumber::digitCount() const
 {
-    if (_decimalPoint > other._decimalPoint)
-    {
-        return false;
-    }
-    else if (_decimalPoint < other._decimalPoint)
-    {
-        return true;
-    }
-
-    BigNumber left = this->truncate(_precision);
-    BigNumber right = other.truncate(_precision);
+    if (_limbs.empty())
+        return 0;
 
-    int maxSize = max(left._digits.size(), right._digits.size());
+    return (int64_t)(_limbs.size() - 1) * BASE_DIGITS + LimbArith::digitCount(_limbs.back());
+}
 
-    for (int i = 0; i < maxSize; i++)
-    {
-        if (i >= left._digits.size())
-            return true;
-        if (i >= right._digits.size())
-            return false;
+// Multiplies the mantissa by 10^digits, the exponent stays in place
+void BigNumber::shiftMantissaLeft(int64_t digits)
+{
+    if (_limbs.empty() || digits <= 0)
+        return;
 
-        if (left._digits[i] < right._digits[i])
-            return true;
+    size_t wholeLimbs = digits / BASE_DIGITS;
+    int rest = digits % BASE_DIGITS;
 
-        if (left._digits[i] > right._digits[i])
-            return false;
+    if (rest)
+    {
+        uint64_t carry = mulSmall(_limbs.data(), _limbs.data(), _limbs.size(), POW10[rest]);
+        if (carry)
+            _limbs.push_back(carry);
     }
-
-    return false;
+    _limbs.insert(_limbs.begin(), wholeLimbs, 0);
 }
 
-BigNumber BigNumber::addAbsValue(const BigNumber &other) const
+// Divides the mantissa by 10^digits dropping the remainder
+void BigNumber::shiftMantissaRight(int64_t digits)
 {
+    if (_limbs.empty() || digits <= 0)
+        return;
 
-    BigNumber res;
-    res._isNegative = false;
+    uint64_t wholeLimbs = digits / BASE_DIGITS;
+    int rest = digits % BASE_DIGITS;
 
-    BigNumber left = *this;
-    BigNumber right = other;
-
-    allignDecimalPlaces(left, right);
-
-    if (left._digits.size() < 19 && right._digits.size() < 19)
+    if (wholeLimbs >= _limbs.size())
     {
-        res = left.directAdd(right);
-        res._digits.insert(0, 1, '0');
-
-        // remove the zero after the decimal point
-        res._digits.erase(res._digits.end() - 1);
+        _limbs.clear();
+        return;
     }
-    else
-    {
-        res._digits.reserve(std::max(left._digits.size(), right._digits.size()) + 3);
+    _limbs.erase(_limbs.begin(), _limbs.begin() + wholeLimbs);
 
-        uint8_t carry = 0;
-        uint8_t temp = 0;
+    if (rest)
+        divSmall(_limbs.data(), _limbs.data(), _limbs.size(), POW10[rest]);
 
-        int i = left._digits.size() - 1;
-        int j = right._digits.size() - 1;
-
-        while (i >= 0 || j >= 0 || carry)
-        {
-            temp = carry;
+    while (!_limbs.empty() && _limbs.back() == 0)
+        _limbs.pop_back();
+}
 
-            if (i >= 0)
-                temp += left._digits[i--] - '0';
-            if (j >= 0)
-                temp += right._digits[j--] - '0';
+// Compares |left| with |right| without aligning copies of them
+int BigNumber::compareMagnitude(const BigNumber &left, const BigNumber &right)
+{
+    if (left._limbs.empty() || right._limbs.empty())
+        return (int)!left._limbs.empty() - (int)!right._limbs.empty();
 
-            carry = temp / 10;
+    int64_t leftOrder = left.orderOfMagnitude();
+    int64_t rightOrder = right.orderOfMagnitude();
 
-            res._digits += temp % 10 + '0';
-        }
+    if (leftOrder != rightOrder)
+        return leftOrder < rightOrder ? -1 : 1;
 
-        reverse(res._digits.begin(), res._digits.end());
+    if (left._exponent >= right._exponent)
+    {
+        int64_t shift = left._exponent - right._exponent;
+        return -compareShifted(right._limbs.data(), right._limbs.size(), left._limbs.data(),
+                               left._limbs.size(), shift / BASE_DIGITS, shift % BASE_DIGITS);
     }
-    res._decimalPoint = res._digits.size() - (left._digits.size() - left._decimalPoint);
 
-    res = res.truncate(_precision);
-    res.removeLeadingZeroes();
-    res.removeTrailingZeroes();
-
-    return res;
+    int64_t shift = right._exponent - left._exponent;
+    return compareShifted(left._limbs.data(), left._limbs.size(), right._limbs.data(),
+                          right._limbs.size(), shift / BASE_DIGITS, shift % BASE_DIGITS);
 }
 
-// requires |this| >= |other|
-BigNumber BigNumber::subtractAbsValue(const BigNumber &other) const
+// returns |this|<|other|
+bool BigNumber::compareAbsValue(const BigNumber &other) const
 {
-    assert(!this->compareAbsValue(other));
-
-#pragma region old code
-    // BigNumber res;
-    // res._isNegative = false;
-
-    // BigNumber left = *this;
-    // BigNumber right = other;
+    return compareMagnitude(*this, other) < 0;
+}
 
-    // allignDecimalPlaces(left, right);
+// this = this + other, or this - other when `subtract` is set
+// The result is accumulated in the limbs of this
+void BigNumber::addInPlace(const BigNumber &other, bool subtract, int precision)
+{
+    if (&other == this)
+    {
+        BigNumber copy = other;
+        addInPlace(copy, subtract, precision);
+        return;
+    }
 
-    // int maxIntLen = max(left._decimalPoint, right._decimalPoint);
-    // int leftPad = maxIntLen - left._decimalPoint;
-    // int rightPad = maxIntLen - right._decimalPoint;
+    bool otherNegative = other._isNegative != subtract;
 
-    // left._digits.insert(0, leftPad, '0');
-    // left._decimalPoint += leftPad;
+    if (other._limbs.empty())
+    {
+        truncateInPlace(precision);
+        return;
+    }
 
-    // right._digits.insert(0, rightPad, '0');
-    // right._decimalPoint += rightPad;
+    if (_limbs.empty())
+    {
+        _limbs = other._limbs;
+        _exponent = other._exponent;
+        _isNegative = otherNegative;
+        truncateInPlace(precision);
+        return;
+    }
 
-    // int totalDigits = left._digits.size();
-    // res._digits.resize(totalDigits, '0');
+    // Bring both exponents to the smaller one, other is shifted on the fly
+    if (_exponent > other._exponent)
+    {
+        shiftMantissaLeft(_exponent - other._exponent);
+        _exponent = other._exponent;
+    }
 
-    // if (left._digits.size() < 19 && right._digits.size() < 19)
-    // {
-    //     res = left.directSubtract(right);
-    //     res._digits.erase(res._digits.end() - 1);
+    int64_t shift = other._exponent - _exponent;
+    size_t limbs = shift / BASE_DIGITS;
+    int rest = shift % BASE_DIGITS;
 
-    //     int zeroesToAdd = totalDigits - res._digits.size();
+    const uint64_t *otherLimbs = other._limbs.data();
+    size_t otherSize = other._limbs.size();
+    size_t shiftedOtherSize = shiftedSize(otherLimbs, otherSize, limbs, rest);
 
-    //     res._digits.insert(0, zeroesToAdd, '0');
-    // }
-    // else
-    // {
-    //     int borrow = 0;
+    if (_isNegative == otherNegative)
+    {
+        _limbs.resize(max(_limbs.size(), shiftedOtherSize) + 1);
+        addShifted(_limbs.data(), _limbs.size(), otherLimbs, otherSize, limbs, rest);
+    }
+    else if (compareShifted(_limbs.data(), _limbs.size(), otherLimbs, otherSize, limbs, rest) >= 0)
+    {
+        subShifted(_limbs.data(), _limbs.size(), otherLimbs, otherSize, limbs, rest);
+    }
+    else
+    {
+        _limbs.resize(shiftedOtherSize);
+        subFromShifted(_limbs.data(), _limbs.size(), otherLimbs, otherSize, limbs, rest);
+        _isNegative = otherNegative;
+    }
 
-    //     for (int i = totalDigits - 1; i >= 0; --i)
-    //     {
-    //         int leftDigit = left._digits[i] - '0' - borrow;
-    //         borrow = 0;
+    removeLeadingZeroes();
+    truncateInPlace(precision);
+    removeTrailingZeroes();
+}
 
-    //         int rightDigit = right._digits[i] - '0';
+BigNumber BigNumber::multiplyAbsValue(const BigNumber &other, int precision) const
+{
+    BigNumber res;
 
-    //         if (leftDigit < rightDigit)
-    //         {
-    //             leftDigit += 10;
-    //             borrow = 1;
-    //         }
+    // check if any of the multipliers is zero
+    if (_limbs.empty() || other._limbs.empty())
+    {
+        return res;
+    }
 
-    //         res._digits[i] = (leftDigit - rightDigit) + '0';
-    //     }
-    // }
-    // res._decimalPoint = left._decimalPoint;
+    res._limbs.resize(_limbs.size() + other._limbs.size());
 
-#pragma endregion
+    LimbArith::mul(res._limbs.data(), _limbs.data(), _limbs.size(), other._limbs.data(),
+                   other._limbs.size());
 
-    BigNumber res;
-    res._isNegative = false;
+    res._exponent = _exponent + other._exponent;
 
-    BigNumber left = *this;
-    BigNumber right = other;
+    res.removeLeadingZeroes();
+    res.truncateInPlace(precision);
+    res.removeTrailingZeroes();
 
-    allignDecimalPlaces(left, right);
+    return res;
+}
 
-    if (left._digits.size() < 19 && right._digits.size() < 19)
+BigNumber BigNumber::divideAbsValue(const BigNumber &other, int precision) const
+{
+    if (other._limbs.empty())
     {
-        res = left.directSubtract(right);
-        res._digits.insert(0, 1, '0');
-
-        // remove the zero after the decimal point
-        res._digits.erase(res._digits.end() - 1);
+        throw invalid_argument("The divisor should not be zero");
     }
-    else
+    if (_limbs.empty())
     {
-        res._digits.reserve(std::max(left._digits.size(), right._digits.size()) + 3);
-
-        uint8_t borrow = 0;
-        uint8_t temp = 0;
-        uint8_t toSubtract = 0;
-
-        int i = left._digits.size() - 1;
-        int j = right._digits.size() - 1;
-
-        while (i >= 0 || j >= 0)
-        {
-            temp = 0;
-
-            borrow /= 10;
-            toSubtract = borrow;
+        return BigNumber::_zero;
+    }
 
-            temp += left._digits[i--] - '0';
-            if (j >= 0)
-                toSubtract += right._digits[j--] - '0';
+    // |this| / |other| * 10^precision =
+    // = this._limbs * 10^shift / other._limbs
+    int64_t shift = _exponent - other._exponent + precision;
 
-            if (toSubtract > temp)
-            {
-                temp += 10;
-                borrow = 10;
-            }
-            temp -= toSubtract;
+    BigNumber dividend = *this;
+    BigNumber divisor = other;
 
-            res._digits += temp % 10 + '0';
-        }
+    if (shift >= 0)
+        dividend.shiftMantissaLeft(shift);
+    else
+        divisor.shiftMantissaLeft(-shift);
 
-        reverse(res._digits.begin(), res._digits.end());
-    }
-    int shiftDecimalPoint = (left._digits.size() - left._decimalPoint);
+    BigNumber res;
 
-    if (shiftDecimalPoint >= res._digits.size())
-    {
-        int offset = shiftDecimalPoint - res._digits.size();
-        res._digits.insert(0, offset + 1, '0');
-    }
+    size_t na = dividend._limbs.size();
+    size_t nb = divisor._limbs.size();
+    if (na < nb)
+        return BigNumber::_zero;
 
-    res._decimalPoint = res._digits.size() - shiftDecimalPoint;
+    LimbBuffer remainder(nb, 0);
+    res._limbs.resize(na - nb + 1);
+    LimbArith::div(res._limbs.data(), remainder.data(), dividend._limbs.data(), na,
+                   divisor._limbs.data(), nb);
+    res._exponent = -precision;
 
-    res = res.truncate(_precision);
     res.removeLeadingZeroes();
     res.removeTrailingZeroes();
 
     return res;
 }
 
-BigNumber BigNumber::multiplyAbsValue(const BigNumber &other) const
+// floor(|this| / |other|) and |this| mod |other| of two integers in one
+// pass over the limbs
+BigNumber BigNumber::divModAbsValue(const BigNumber &other, BigNumber &remainder) const
 {
-    BigNumber res = BigNumber::_zero;
+    // integers have non-negative exponents, both are brought to the smaller
+    int64_t exponent = std::min(_exponent, other._exponent);
 
-    res._digits.reserve(this->_digits.size() + other._digits.size() + 5);
+    BigNumber dividend = *this;
+    BigNumber divisor = other;
+    dividend.shiftMantissaLeft(_exponent - exponent);
+    divisor.shiftMantissaLeft(other._exponent - exponent);
+    dividend._exponent = 0;
+    divisor._exponent = 0;
 
-    uint8_t carry = 0;
-    uint8_t temp = 0;
+    size_t na = dividend._limbs.size();
+    size_t nb = divisor._limbs.size();
 
-    // check if any of the multipliers is zero
-    if (*this == res || other == res)
+    BigNumber quotient;
+    BigNumber rest;
+
+    if (na < nb)
     {
-        return res;
+        rest = dividend;
     }
-
-    for (int i = _digits.size() - 1; i >= 0; i--)
+    else
     {
+        quotient._limbs.resize(na - nb + 1);
+        rest._limbs.resize(nb);
+        LimbArith::div(quotient._limbs.data(), rest._limbs.data(), dividend._limbs.data(), na,
+                       divisor._limbs.data(), nb);
+    }
+    rest._exponent = exponent;
 
-        int j = other._digits.size() - 1;
-
-        BigNumber intermediate;
+    quotient.removeLeadingZeroes();
+    quotient.removeTrailingZeroes();
+    rest.removeLeadingZeroes();
+    rest.removeTrailingZeroes();
 
-        while (j >= 0 || carry)
-        {
-            temp = carry;
+    remainder = std::move(rest);
+    return quotient;
+}
 
-            if (j >= 0)
-                temp += (_digits[i] - '0') * (other._digits[j] - '0');
+#pragma endregion
 
-            carry = temp / 10;
+#pragma region multiplication
 
-            intermediate._digits += (temp % 10 + '0');
-            j--;
-        }
-        reverse(intermediate._digits.begin(), intermediate._digits.end());
+// Signed product truncated to `precision` digits after the decimal point
+BigNumber BigNumber::multiply(const BigNumber &left, const BigNumber &right, int precision)
+{
+    BigNumber res = left.multiplyAbsValue(right, precision);
 
-        int rightOffset = _digits.size() - 1 - i;
+    res._isNegative = left._isNegative != right._isNegative;
 
-        intermediate._digits.append(rightOffset + 1, '0');
+    // the product might be truncated to zero
+    res.removeLeadingZeroes();
 
-        intermediate._decimalPoint = intermediate._digits.size() - 1;
+    return res;
+}
 
-        res = res + intermediate;
-    }
+// Signed quotient truncated to `precision` digits after the decimal point
+BigNumber BigNumber::divide(const BigNumber &left, const BigNumber &right, int precision)
+{
+    BigNumber res = left.divideAbsValue(right, precision);
 
-    int digitsAfterPoint1 = _digits.size() - _decimalPoint;
-    int digitsAfterPoint2 = other._digits.size() - other._decimalPoint;
+    res._isNegative = left._isNegative != right._isNegative;
 
-    int resDigitsAfterPoint = digitsAfterPoint1 + digitsAfterPoint2;
+    // the quotient might be truncated to zero
+    res.removeLeadingZeroes();
 
-    int diff = res._decimalPoint - resDigitsAfterPoint - 1;
+    return res;
+}
 
-    if (diff < 0)
+// Product with an integer truncated to `precision` digits after the decimal point
+BigNumber BigNumber::multiplySmall(const BigNumber &left, uint64_t magnitude, bool negative,
+                                   int precision)
+{
+    if (magnitude >= BASE)
     {
-        res._digits.insert(0, -diff, '0');
-        res._decimalPoint = res._digits.size() - 1;
+        BigNumber right;
+        right.assignInteger(magnitude, negative);
+        return multiply(left, right, precision);
     }
 
-    res._decimalPoint -= resDigitsAfterPoint;
+    BigNumber res;
+    if (left._limbs.empty() || magnitude == 0)
+        return res;
+
+    size_t n = left._limbs.size();
+    res._limbs.resize(n + 1);
+    res._limbs[n] = mulSmall(res._limbs.data(), left._limbs.data(), n, magnitude);
+    res._exponent = left._exponent;
+    res._isNegative = left._isNegative != negative;
 
-    res = res.truncate(_precision);
     res.removeLeadingZeroes();
+    res.truncateInPlace(precision);
     res.removeTrailingZeroes();
+    res.removeLeadingZeroes();
 
     return res;
 }
 
-BigNumber BigNumber::divideAbsValue(const BigNumber &other) const
+// Quotient by an integer truncated to `precision` digits after the decimal point
+BigNumber BigNumber::divideSmall(const BigNumber &left, uint64_t magnitude, bool negative,
+                                 int precision)
 {
-
-    BigNumber otherNormalized = other;
-
-    otherNormalized._decimalPoint = otherNormalized._digits.size();
-    otherNormalized.removeLeadingZeroes();
-    otherNormalized._digits += "0";
-    otherNormalized._isNegative = false;
-
-    BigNumber res;
-
-    BigNumber remainder("0");
-
-    bool resReachedDecPart = false;
-
-    int digitsAfterPoint1 = _digits.size() - _decimalPoint;
-    int digitsAfterPoint2 = other._digits.size() - other._decimalPoint;
-
-    int resDigitsAfterPoint = digitsAfterPoint1 - digitsAfterPoint2;
-
-    int maxDivDigits = max(BigNumber::_precision - resDigitsAfterPoint, 0);
-
-    if (other == BigNumber::_zero)
+    if (magnitude == 0)
     {
         throw invalid_argument("The divisor should not be zero");
     }
-    if (*this == BigNumber::_zero)
+    if (magnitude >= BASE)
     {
-        return BigNumber::_zero;
+        BigNumber right;
+        right.assignInteger(magnitude, negative);
+        return divide(left, right, precision);
     }
 
-    int takenZeroes = 0, i = 0;
+    // |left| * 10^precision / magnitude, where dropping digits of the
+    // mantissa first gives the same floor
+    BigNumber res = left;
+    int64_t shift = left._exponent + precision;
 
-    while (takenZeroes <= maxDivDigits)
-    {
-
-        // Choose enough digits to divide
-        do
-        {
-
-            if (i < this->_digits.size())
-            {
-                // Add next digit of `this` to the remainder
-                BigNumber nextDigit = this->_digits[i] - '0';
-
-                remainder = remainder * BigNumber::_ten + nextDigit;
-                i++;
-            }
-            else
-            {
-                if (resReachedDecPart == false)
-                {
-                    res._decimalPoint = res._digits.size();
-                    resReachedDecPart = true;
-                }
-                remainder = remainder * BigNumber::_ten;
-                takenZeroes++;
-            }
-
-            if (remainder < otherNormalized)
-            {
-                res._digits += "0";
-            }
-        } while (remainder < otherNormalized && takenZeroes <= maxDivDigits);
-
-        BigNumber multiplier = 1;
-
-        // Choose the multiplier
-        while (multiplier * otherNormalized <= remainder)
-        {
-            multiplier += 1;
-        }
-
-        multiplier = multiplier - BigNumber::_one;
-
-        remainder = remainder - otherNormalized * multiplier;
-
-        res._digits += multiplier._digits[0];
-    }
+    if (shift >= 0)
+        res.shiftMantissaLeft(shift);
+    else
+        res.shiftMantissaRight(-shift);
 
-    res._decimalPoint -= resDigitsAfterPoint;
+    divSmall(res._limbs.data(), res._limbs.data(), res._limbs.size(), magnitude);
+    res._exponent = -precision;
+    res._isNegative = left._isNegative != negative;
 
-    res = res.truncate(_precision);
     res.removeLeadingZeroes();
     res.removeTrailingZeroes();
 
     return res;
 }
 
-BigNumber BigNumber::directAdd(const BigNumber &other) const
+// |this| mod magnitude for an integer, limb by limb from the top; with a
+// remainder below 2^64 every step fits in 128 bits
+uint64_t BigNumber::remainderSmall(uint64_t magnitude) const
 {
-    // assert(this->_digits.size() < 19);
-    // assert(other._digits.size() < 19);
+    if (!isInt())
+        throw invalid_argument("Modulus requires integer operands");
+    if (magnitude == 0)
+        throw invalid_argument("Modulus by zero");
 
-    uint64_t left = std::stoll(this->_digits);
-    uint64_t right = std::stoll(other._digits);
+    uint128 res = 0;
+    for (size_t i = _limbs.size(); i-- > 0;)
+        res = (res * BASE + _limbs[i]) % magnitude;
 
-    uint64_t result = left + right;
+    // times 10^exponent mod magnitude
+    uint128 power = 10 % magnitude;
+    for (int64_t e = _exponent; e > 0; e >>= 1)
+    {
+        if (e & 1)
+            res = res * power % magnitude;
+        power = power * power % magnitude;
+    }
 
-    return std::to_string(result);
+    return (uint64_t)res;
 }
 
-BigNumber BigNumber::directSubtract(const BigNumber &other) const
+// The limb kernels see the same array twice and take the squaring path
+BigNumber BigNumber::square() const
 {
-
-    // assert(this->_digits.size() < 19);
-    // assert(other._digits.size() < 19);
-    // assert(!this->compareAbsValue(other));
-
-    uint64_t left = std::stoll(this->_digits);
-    uint64_t right = std::stoll(other._digits);
-
-    uint64_t result = left - right;
-
-    return std::to_string(result);
+    return multiply(*this, *this, workingPrecision());
 }
 
-BigNumber BigNumber::directMultiply(const BigNumber &other) const
+int BigNumber::checkedDigits(int digits)
 {
-    // assert(this->_digits.size() + other._digits.size() < 21);
-
-    uint64_t left = std::stoll(this->_digits) / 10;
-    uint64_t right = std::stoll(other._digits) / 10;
-
-    uint64_t result = left * right;
-
-    return std::to_string(result);
+    if (digits < 0)
+        throw invalid_argument("Precision cannot be less than zero");
+    return digits;
 }
 
-BigNumber BigNumber::fastMod(const BigNumber &p) const
+BigNumber BigNumber::add(const BigNumber &left, const BigNumber &right, int digits)
 {
-    BigNumber a = *this;
-
-    assert(a >= 0 && p > 0);
-
-    while (a >= p)
-    {
-        a -= p;
-    }
-    return a;
+    BigNumber res = left;
+    res.addInPlace(right, false, checkedDigits(digits));
+    return res;
 }
 
-#pragma endregion
-
-#pragma region multiplication
-
-// splitNumber function specifies the number of digits
-// to extract from the right
-std::pair<BigNumber, BigNumber> BigNumber::splitNumber(int pos) const
+BigNumber BigNumber::sub(const BigNumber &left, const BigNumber &right, int digits)
 {
-    std::pair<BigNumber, BigNumber> result;
-
-    int length = this->_digits.length() - 1;
-
-    result.first = this->_digits.substr(0, length - pos);
-    result.second = this->_digits.substr(length - pos, pos);
-
-    return result;
+    BigNumber res = left;
+    res.addInPlace(right, true, checkedDigits(digits));
+    return res;
 }
 
-BigNumber BigNumber::shiftIntegerLeft(int decPlaces) const
+BigNumber BigNumber::mul(const BigNumber &left, const BigNumber &right, int digits)
 {
-
-    BigNumber result = *this;
-
-    result._digits.append(decPlaces, '0');
-
-    result._decimalPoint += decPlaces;
-
-    return result;
+    return multiply(left, right, checkedDigits(digits));
 }
 
-int BigNumber::makeEqualLength(BigNumber &n1, BigNumber &n2)
+BigNumber BigNumber::div(const BigNumber &left, const BigNumber &right, int digits)
 {
-    int diff = n1._digits.length() - n2._digits.length();
-    if (diff > 0)
-    {
-        n2._digits.insert(0, diff, '0'); // prepend to left
-        n2._decimalPoint += diff;
-    }
-    else if (diff < 0)
-    {
-        n1._digits.insert(0, -diff, '0'); // prepend to right
-        n1._decimalPoint += -diff;
-    }
-    return n1._digits.length();
+    return divide(left, right, checkedDigits(digits));
 }
 
-// find product of two integers using karatsuba algorithm
-// https://en.wikipedia.org/wiki/Karatsuba_algorithm
-// not recursive(currently)
-BigNumber BigNumber::karatsubaMult(const BigNumber &other) const
+BigNumber BigNumber::scale(const BigNumber &x, int64_t power, int digits)
 {
-    // assert(this->isInt());
-    // assert(other.isInt());
+    BigNumber res = x;
 
-    // base case
-    if (this->_digits.size() + other._digits.size() < 21)
-        return this->directMultiply(other);
-
-    BigNumber left = *this;
-    BigNumber right = other;
-
-    int n = makeEqualLength(left, right);
-
-    // Add zeros in the beginning of
-    // the strings when length of integer part
-    // is odd
-    if (n % 2 == 0)
-    {
-        left._digits.insert(0, 1, '0');
-        right._digits.insert(0, 1, '0');
-        n++;
-    }
-
-    int n2 = n / 2;
-
-    auto leftSplit = left.splitNumber(n2);
-    auto rightSplit = right.splitNumber(n2);
-
-    BigNumber z0, z1, z2;
-
-    z0 = leftSplit.second.karatsubaMult(rightSplit.second);
-    z1 = (leftSplit.first + leftSplit.second);
-    z1 = z1.karatsubaMult(rightSplit.first + rightSplit.second);
-    z2 = leftSplit.first.karatsubaMult(rightSplit.first);
+    if (res._limbs.empty())
+        return res;
 
-    // z0 = leftSplit.second.multiplyAbsValue(rightSplit.second);
-    // z1 = (leftSplit.first + leftSplit.second);
-    // z1 = z1.multiplyAbsValue(rightSplit.first + rightSplit.second);
-    // z2 = leftSplit.first.multiplyAbsValue(rightSplit.first);
+    res._exponent += power;
 
-    BigNumber p = z2.shiftIntegerLeft(n2 * 2);
-    BigNumber q = z1 - z2 - z0;
-    q = q.shiftIntegerLeft(n2);
+    if (power < 0)
+        res.truncateInPlace(checkedDigits(digits));
 
-    return p + q + z0;
+    return res;
 }
 
-BigNumber BigNumber::optimizedMultAbsValue(const BigNumber &other) const
+BigNumber BigNumber::divMod(const BigNumber &left, const BigNumber &right, BigNumber &remainder)
 {
-    BigNumber leftNormalized{this->_digits};
-    BigNumber rightNormalized{other._digits};
-
-    int sizeDifference = std::abs((int64_t)this->_digits.size() - (int64_t)other._digits.size());
-
-    BigNumber result;
-    if (sizeDifference > 80)
-        return this->multiplyAbsValue(other);
-    else
-        result = leftNormalized.karatsubaMult(rightNormalized);
-
-    // Decimal places handling logic
-    int digitsAfterPoint1 = _digits.size() - _decimalPoint;
-    int digitsAfterPoint2 = other._digits.size() - other._decimalPoint;
-
-    int resDigitsAfterPoint = digitsAfterPoint1 + digitsAfterPoint2;
-
-    int diff = result._decimalPoint - resDigitsAfterPoint;
+    if (!left.isInt() || !right.isInt())
+        throw invalid_argument("Modulus requires integer operands");
+    if (right._limbs.empty())
+        throw invalid_argument("Modulus by zero");
 
-    if (diff <= 0)
-    {
-        result._digits.insert(0, -diff + 1, '0');
-        result._decimalPoint = result._digits.size() - 1;
-    }
+    BigNumber rest;
+    BigNumber quotient = left.divModAbsValue(right, rest);
 
-    result._decimalPoint -= resDigitsAfterPoint;
+    quotient._isNegative = left._isNegative != right._isNegative;
+    rest._isNegative = left._isNegative;
 
-    result = result.truncate(_precision);
-    result.removeLeadingZeroes();
-    result.removeTrailingZeroes();
+    // zero has no sign
+    quotient.removeLeadingZeroes();
+    rest.removeLeadingZeroes();
 
-    return result;
-}
-
-BigNumber BigNumber::multiplyHandler(const BigNumber &other) const
-{
-    return optimizedMultAbsValue(other);
-    // return multiplyAbsValue(other);
+    remainder = std::move(rest);
+    return quotient;
 }
 
 #pragma endregion
@@ -625,15 +520,7 @@ BigNumber BigNumber::multiplyHandler(const BigNumber &other) const
 // checks if the number is int (has no fractional part)
 bool BigNumber::isInt() const
 {
-    if (this->_decimalPoint != this->_digits.size() - 1)
-        return false;
-
-    string frac = this->_digits.substr(this->_decimalPoint);
-
-    if (frac == "0")
-        return true;
-
-    return false;
+    return _exponent >= 0;
 }
 
 BigNumber BigNumber::abs() const
@@ -654,25 +541,22 @@ BigNumber BigNumber::truncate(int precision) const
         throw invalid_argument("Precision cannot be less than zero");
 
     BigNumber res = *this;
+    res.truncateInPlace(precision);
 
-    int digitsAfterPoint = this->_digits.size() - this->_decimalPoint;
-
-    if (digitsAfterPoint <= precision)
-        return res;
+    return res;
+}
 
-    int diff = digitsAfterPoint - precision;
+void BigNumber::truncateInPlace(int precision)
+{
+    if (_exponent >= -precision)
+        return;
 
-    res._digits = res._digits.substr(0, res._digits.size() - diff);
+    shiftMantissaRight(-precision - _exponent);
+    _exponent = -precision;
 
-    if (precision == 0)
-    {
-        res._digits += "0";
-    }
     // negative number might get truncated to -0.0
-    res._isNegative = res < 0;
-    res.removeTrailingZeroes();
-
-    return res;
+    removeLeadingZeroes();
+    removeTrailingZeroes();
 }
 
 BigNumber BigNumber::round(int precision) const
@@ -680,53 +564,56 @@ BigNumber BigNumber::round(int precision) const
     if (precision < 0)
         throw invalid_argument("Precision cannot be less than zero");
 
-    BigNumber res = *this;
+    if (_exponent >= -precision)
+        return *this;
 
-    int digitsAfterPoint = this->_digits.size() - this->_decimalPoint;
+    BigNumber res = this->truncate(precision);
 
-    if (digitsAfterPoint <= precision)
-        return res;
+    // First dropped digit
+    uint64_t position = -precision - _exponent - 1;
+    uint64_t lastDigit = 0;
 
-    int diff = digitsAfterPoint - precision;
-    res._digits = res._digits.substr(0, res._digits.size() - diff);
-
-    char lastDigit = _digits[_digits.size() - diff];
+    if (position / BASE_DIGITS < _limbs.size())
+        lastDigit = _limbs[position / BASE_DIGITS] / POW10[position % BASE_DIGITS] % 10;
 
     // Check if the last digit is 5 or greater
-    if (lastDigit >= '5')
+    if (lastDigit >= 5)
     {
         // Make a temporary number with 0.0...0001 and add it to the number
         BigNumber toAdd;
-        toAdd._digits.insert(0, precision, '0');
-        toAdd._digits += "1";
-        toAdd._decimalPoint = 1;
-
-        toAdd._digits += "0";
-        res = res.abs() + toAdd;
-        res._isNegative = this->_isNegative;
-    }
+        toAdd._limbs.push_back(1);
+        toAdd._exponent = -precision;
 
-    if (res._decimalPoint == res._digits.size())
-    {
-        res._digits += "0";
+        toAdd._isNegative = _isNegative;
+        res.addInPlace(toAdd, false, precision);
     }
 
     // a negative number might get rounded to -0.0
-    res._isNegative = res < 0;
-
-    res.removeTrailingZeroes();
+    res.removeLeadingZeroes();
 
     return res;
 }
 
 bool BigNumber::isOdd() const
 {
-    if (!isInt())
+    // a positive exponent means the number ends with a zero
+    if (_exponent != 0 || _limbs.empty())
         return false;
 
-    uint8_t lastDigit = this->_digits[this->_digits.size() - 2] - '0';
+    return _limbs[0] % 2 == 1;
+}
 
-    return lastDigit % 2 == 1;
+// Position of the most significant digit relative to the decimal point:
+// a non-zero number lies in [10^(order - 1); 10^order)
+int64_t BigNumber::orderOfMagnitude() const
+{
+    return digitCount() + _exponent;
+}
+
+// Multiplies the number by 10^power by moving the exponent only
+BigNumber BigNumber::scaleByPowerOfTen(int64_t power) const
+{
+    return scale(*this, power, workingPrecision());
 }
 
 bool BigNumber::isNegative() const
@@ -738,114 +625,54 @@ bool BigNumber::isNegative() const
 
 #pragma region Operators
 
-BigNumber BigNumber::operator+(const BigNumber &other) const
+BigNumber operator+(BigNumber left, const BigNumber &right)
 {
+    left += right;
 
-    BigNumber res;
+    return left;
+}
 
-    if (_isNegative == other._isNegative)
-    {
-        res = addAbsValue(other);
-        res._isNegative = _isNegative;
-    }
-    else if (compareAbsValue(other))
-    {
-        res = other.subtractAbsValue(*this);
-        res._isNegative = other._isNegative;
-    }
-    else
-    {
-        res = subtractAbsValue(other);
-        res._isNegative = _isNegative;
-    }
+BigNumber operator+(const BigNumber &left, BigNumber &&right)
+{
+    right += left;
 
-    return res;
+    return std::move(right);
 }
 
-BigNumber BigNumber::operator-(const BigNumber &other) const
+BigNumber operator-(BigNumber left, const BigNumber &right)
 {
+    left -= right;
 
-    BigNumber res;
-    if (_isNegative != other._isNegative)
-    {
-        res = addAbsValue(other);
-        res._isNegative = _isNegative;
-    }
-    else if (compareAbsValue(other))
-    {
-        res = other.subtractAbsValue(*this);
-        res._isNegative = !_isNegative;
-    }
-    else
-    {
-        res = subtractAbsValue(other);
-        res._isNegative = _isNegative;
-    }
-
-    return res;
+    return left;
 }
 
-BigNumber BigNumber::operator*(const BigNumber &other) const
+// left - right = -(right - left)
+BigNumber operator-(const BigNumber &left, BigNumber &&right)
 {
+    right -= left;
+    right._isNegative = !right._isNegative && !right._limbs.empty();
 
-    BigNumber res;
+    return std::move(right);
+}
 
-    if (_isNegative == other._isNegative)
-    {
-        res = multiplyHandler(other);
-        res._isNegative = false;
-    }
-    else
-    {
-        res = multiplyHandler(other);
-        res._isNegative = true;
-    }
+BigNumber BigNumber::operator*(const BigNumber &other) const
+{
 
-    return res;
+    return multiply(*this, other, workingPrecision());
 }
 
 BigNumber BigNumber::operator/(const BigNumber &other) const
 {
 
-    BigNumber res;
-
-    if (_isNegative == other._isNegative)
-    {
-        res = divideAbsValue(other);
-        res._isNegative = false;
-    }
-    else
-    {
-        res = divideAbsValue(other);
-        res._isNegative = true;
-    }
-
-    return res;
+    return divide(*this, other, workingPrecision());
 }
 
 BigNumber BigNumber::operator%(const BigNumber &other) const
 {
-
-    if (!isInt() || !other.isInt())
-        throw invalid_argument("Modulus requires integer operands");
-
-    BigNumber div = other.abs();
-
-    if (other == 0)
-        throw invalid_argument("Modulus by zero");
-
-    if (*this < 0)
-        return -(-(*this) % div);
-
-    // If size difference is small, do modulus by repeated subtraction
-    if (std::abs((int64_t)this->_digits.size() - (int64_t)other._digits.size()) < 8)
-        return fastMod(div);
-
-    // Else do by division
-    BigNumber res = *this;
-    BigNumber q = (res / other).truncate(0);
-
-    res = res - q * other;
+    // the remainder comes out of the same limb division as the quotient,
+    // which takes schoolbook or Newton time whatever the operand sizes
+    BigNumber res;
+    divMod(*this, other, res);
 
     return res;
 }
@@ -856,7 +683,7 @@ bool BigNumber::operator<(const BigNumber &other) const
     if (_isNegative && !other._isNegative)
         return true;
     else if (_isNegative && other._isNegative)
-        return compareAbsValue(other);
+        return other.compareAbsValue(*this);
     else if (!_isNegative && other._isNegative)
         return false;
     else
@@ -886,22 +713,13 @@ bool BigNumber::operator!=(const BigNumber &other) const
 
 bool BigNumber::operator==(const BigNumber &other) const
 {
-    if (_digits.size() != other._digits.size())
-        return false;
-
-    if (_decimalPoint != other._decimalPoint)
+    if (_exponent != other._exponent)
         return false;
 
     if (_isNegative != other._isNegative)
         return false;
 
-    for (int i = 0; i < _digits.size(); i++)
-    {
-        if (_digits[i] != other._digits[i])
-            return false;
-    }
-
-    return true;
+    return _limbs == other._limbs;
 }
 
 BigNumber &BigNumber::operator=(const string &str)
@@ -916,7 +734,22 @@ BigNumber &BigNumber::operator=(const string &str)
 BigNumber &BigNumber::operator+=(const BigNumber &other)
 {
 
-    *this = *this + other;
+    addInPlace(other, false, workingPrecision());
+
+    return *this;
+}
+
+// Accumulates into whichever operand already has the larger buffer
+BigNumber &BigNumber::operator+=(BigNumber &&other)
+{
+
+    if (other._limbs.capacity() > _limbs.capacity())
+    {
+        other.addInPlace(*this, false, workingPrecision());
+        *this = std::move(other);
+    }
+    else
+        addInPlace(other, false, workingPrecision());
 
     return *this;
 }
@@ -924,7 +757,23 @@ BigNumber &BigNumber::operator+=(const BigNumber &other)
 BigNumber &BigNumber::operator-=(const BigNumber &other)
 {
 
-    *this = *this - other;
+    addInPlace(other, true, workingPrecision());
+
+    return *this;
+}
+
+BigNumber &BigNumber::operator-=(BigNumber &&other)
+{
+
+    if (other._limbs.capacity() > _limbs.capacity())
+    {
+        // this - other = -(other - this)
+        other.addInPlace(*this, true, workingPrecision());
+        other._isNegative = !other._isNegative && !other._limbs.empty();
+        *this = std::move(other);
+    }
+    else
+        addInPlace(other, true, workingPrecision());
 
     return *this;
 }
@@ -960,6 +809,9 @@ BigNumber BigNumber::operator-() const
 
     res._isNegative = !this->_isNegative;
 
+    // zero has no sign
+    res.removeLeadingZeroes();
+
     return res;
 }
 
@@ -971,44 +823,76 @@ BigNumber BigNumber::operator-() const
 // their results
 // Also sets the printPrecision which is less than actual
 // operations precision
+// Inside a PrecisionScope only the calling thread's scope is changed,
+// otherwise the default of all threads without a scope
 void BigNumber::setPrecision(int precision)
+{
+    PrecisionContext context = makeContext(precision);
+
+    if (currentScope)
+        currentScope->_context = context;
+    else
+        defaultContext.store(context);
+}
+
+int BigNumber::getPrecision()
+{
+    return currentContext().printPrecision;
+}
+
+BigNumber::PrecisionContext BigNumber::getPrecisionContext()
+{
+    return currentContext();
+}
+
+BigNumber::PrecisionContext BigNumber::makeContext(int precision)
 {
     if (precision < 1)
         throw invalid_argument("Precision should not be less than 1");
-    BigNumber::_precision = precision + 6;
-    BigNumber::_printPrecision = precision;
+    if (precision > EXACT_PRECISION - 7)
+        throw invalid_argument("Precision is too large");
+
+    return PrecisionContext{precision + 6, precision};
 }
 
-int BigNumber::getPrecision()
+BigNumber::PrecisionContext BigNumber::currentContext()
 {
-    return BigNumber::_printPrecision;
+    return currentScope ? currentScope->_context : defaultContext.load();
 }
 
-bool BigNumber::isValidInput(const string &str)
+int BigNumber::workingPrecision()
 {
+    return currentContext().precision;
+}
 
-    for (int i = 0; i < str.size(); i++)
-    {
-        if (!isdigit(str[i]) && str[i] != '.' && str[i] != '-')
-        {
-            return false;
-        }
-    }
-    return true;
+BigNumber::PrecisionScope::PrecisionScope(int precision)
+    : _context(makeContext(precision)), _previous(currentScope)
+{
+    currentScope = this;
 }
 
-void BigNumber::allignDecimalPlaces(BigNumber &left, BigNumber &right)
+BigNumber::PrecisionScope::~PrecisionScope()
 {
+    currentScope = _previous;
+}
 
-    int leftFracLen = left._digits.size() - left._decimalPoint;
-    int rightFracLen = right._digits.size() - right._decimalPoint;
-    int diff = rightFracLen - leftFracLen;
+// Accepts an optional minus sign followed by digits with at most one decimal point
+bool BigNumber::isValidInput(const string &str)
+{
+    size_t begin = (!str.empty() && str[0] == '-') ? 1 : 0;
+    bool hasDigits = false;
+    bool hasPoint = false;
 
-    // Check which num has more digits after decimal point
-    if (diff > 0)
-        left._digits.append(diff, '0'); // Append to left
-    else if (diff < 0)
-        right._digits.append(-diff, '0'); // Append to right
+    for (size_t i = begin; i < str.size(); i++)
+    {
+        if (str[i] == '.' && !hasPoint)
+            hasPoint = true;
+        else if (isdigit(str[i]))
+            hasDigits = true;
+        else
+            return false;
+    }
+    return hasDigits;
 }
 
 #pragma endregion
@@ -1024,31 +908,55 @@ BigNumber::BigNumber(const string &str)
         throw logic_error("Invalid number format");
     }
 
+    string digits;
+
     if (str[0] == '-')
     {
         _isNegative = true;
-        _digits = str.substr(1);
+        digits = str.substr(1);
     }
     else
     {
-        _digits = str;
+        digits = str;
         _isNegative = false;
     }
 
-    int decimal = str.find(".");
+    size_t decimal = digits.find(".");
+
+    if (decimal != digits.npos)
+    {
+        _exponent = -(int64_t)(digits.size() - decimal - 1);
+        digits.erase(decimal, 1);
+    }
+
+    // Read limbs starting from the least significant digits
+    for (size_t end = digits.size(); end > 0;)
+    {
+        size_t begin = end >= (size_t)BASE_DIGITS ? end - BASE_DIGITS : 0;
 
-    if (decimal == str.npos)
-        _digits += ".0";
+        uint64_t limb = 0;
+        for (size_t i = begin; i < end; i++)
+            limb = limb * 10 + (digits[i] - '0');
 
-    _decimalPoint = _digits.find(".");
-    _digits.erase(_decimalPoint, 1);
+        _limbs.push_back(limb);
+        end = begin;
+    }
 
-    *this = this->truncate(_precision);
     removeLeadingZeroes();
+    truncateInPlace(workingPrecision());
     removeTrailingZeroes();
+}
 
-    if (_digits == "00")
-        _isNegative = false;
+void BigNumber::assignInteger(uint64_t magnitude, bool negative)
+{
+    _limbs.clear();
+    _limbs.push_back(magnitude % BASE);
+    _limbs.push_back(magnitude / BASE);
+    _exponent = 0;
+    _isNegative = negative;
+
+    removeLeadingZeroes();
+    removeTrailingZeroes();
 }
 
 BigNumber::BigNumber(double num)
@@ -1056,8 +964,8 @@ BigNumber::BigNumber(double num)
 
     string temp = to_string(num);
     int decLength = temp.find('.');
-    if (decLength == string::npos)
-        decLength == temp.size();
+    if (decLength == (int)string::npos)
+        decLength = temp.size();
 
     std::stringstream ss;
 
@@ -1074,13 +982,39 @@ BigNumber::BigNumber(double num)
 string BigNumber::toString()
 {
 
-    BigNumber temp = this->round(BigNumber::_printPrecision);
-    temp.removeTrailingZeroes();
+    BigNumber temp = this->round(currentContext().printPrecision);
+
+    string res;
+
+    for (size_t i = temp._limbs.size(); i-- > 0;)
+    {
+        string limb = to_string(temp._limbs[i]);
+
+        if (i + 1 != temp._limbs.size())
+            res.append(BASE_DIGITS - limb.size(), '0');
+        res += limb;
+    }
 
-    string res = temp._digits;
+    if (res.empty())
+        res = "0";
 
-    res.insert(temp._decimalPoint, ".");
-    if (_isNegative)
+    if (temp._exponent >= 0)
+    {
+        res.append(temp._exponent, '0');
+        res += ".0";
+    }
+    else
+    {
+        uint64_t fracDigits = -temp._exponent;
+
+        // at least one digit before the decimal point
+        if (res.size() <= fracDigits)
+            res.insert(0, fracDigits - res.size() + 1, '0');
+
+        res.insert(res.size() - fracDigits, ".");
+    }
+
+    if (temp._isNegative)
     {
         res.insert(0, "-");
     }
@@ -1088,4 +1022,4 @@ string BigNumber::toString()
     return res;
 }
 
-#pragma endregion
\ No newline at end of file
+#pragma endregion
@@ -1,18 +1,65 @@
 #pragma once
 
 #include "bigNumFn.h"
+#include "limbBuffer.h"
 #include <cstdint>
 #include <string>
+#include <type_traits>
+
+namespace BigNumExpr
+{
+    class Evaluator;
+}
+
+namespace BigNumFn
+{
+    class ModContext;
+}
 
 class BigNumber
 {
 private:
-    std::string _digits;
-    uint16_t _decimalPoint;
+    // Mantissa as little-endian base 10^19 limbs, empty for zero
+    // The value is _limbs * 10^_exponent, the mantissa never ends with a zero digit
+    // Short mantissas are stored inline without touching the heap
+    LimbBuffer _limbs;
+    int64_t _exponent = 0;
     bool _isNegative = false;
 
-    static int _precision;
-    static int _printPrecision;
+public:
+    // Digits kept after the decimal point by arithmetic and by toString
+    struct PrecisionContext
+    {
+        int precision;
+        int printPrecision;
+    };
+
+    // Gives the calling thread its own precision until the scope ends,
+    // scopes nest and other threads are not affected
+    class PrecisionScope
+    {
+    public:
+        // Same meaning as the argument of setPrecision
+        explicit PrecisionScope(int precision);
+        ~PrecisionScope();
+
+        PrecisionScope(const PrecisionScope &) = delete;
+        PrecisionScope &operator=(const PrecisionScope &) = delete;
+
+    private:
+        PrecisionContext _context;
+        PrecisionScope *_previous;
+
+        friend class BigNumber;
+    };
+
+private:
+    // Precision that never truncates, used for exact intermediate results
+    static const int EXACT_PRECISION = INT32_MAX;
+
+    static PrecisionContext makeContext(int precision);
+    static PrecisionContext currentContext();
+    static int workingPrecision();
 
     static const BigNumber _zero;
     static const BigNumber _one;
@@ -22,25 +69,48 @@ private:
     void removeTrailingZeroes();
     void removeLeadingZeroes();
     static bool isValidInput(const std::string &str);
-    static void allignDecimalPlaces(BigNumber &left, BigNumber &right);
+    static int compareMagnitude(const BigNumber &left, const BigNumber &right);
     bool compareAbsValue(const BigNumber &other) const;
+    int64_t digitCount() const;
+    void shiftMantissaLeft(int64_t digits);
+    void shiftMantissaRight(int64_t digits);
+
+    void addInPlace(const BigNumber &other, bool subtract, int precision);
+    void truncateInPlace(int precision);
+
+    BigNumber multiplyAbsValue(const BigNumber &other, int precision) const;
+    BigNumber divideAbsValue(const BigNumber &other, int precision) const;
+    BigNumber divModAbsValue(const BigNumber &other, BigNumber &remainder) const;
+
+    static BigNumber multiply(const BigNumber &left, const BigNumber &right, int precision);
+    static BigNumber divide(const BigNumber &left, const BigNumber &right, int precision);
 
-    BigNumber addAbsValue(const BigNumber &other) const;
-    BigNumber subtractAbsValue(const BigNumber &other) const;
-    BigNumber multiplyAbsValue(const BigNumber &other) const;
-    BigNumber divideAbsValue(const BigNumber &other) const;
+    // Overloads taking a machine integer are enabled through this
+    template <typename T>
+    using IfInteger = typename std::enable_if<std::is_integral<T>::value, int>::type;
 
-    BigNumber directAdd(const BigNumber &other) const;
-    BigNumber directSubtract(const BigNumber &other) const;
-    BigNumber directMultiply(const BigNumber &other) const;
-    BigNumber fastMod(const BigNumber &p) const;
+    // |num| without overflowing on the most negative value
+    template <typename T> static uint64_t integerMagnitude(T num)
+    {
+        return num < T(0) ? 0 - (uint64_t)num : (uint64_t)num;
+    }
 
-    std::pair<BigNumber, BigNumber> splitNumber(int pos) const;
-    static int makeEqualLength(BigNumber &n1, BigNumber &n2);
-    BigNumber shiftIntegerLeft(int decPlaces) const;
-    BigNumber karatsubaMult(const BigNumber &other) const;
-    BigNumber optimizedMultAbsValue(const BigNumber &other) const;
-    BigNumber multiplyHandler(const BigNumber &other) const;
+    void assignInteger(uint64_t magnitude, bool negative);
+    static int checkedDigits(int digits);
+
+    // Single pass over the limbs when the magnitude is below BASE
+    static BigNumber multiplySmall(const BigNumber &left, uint64_t magnitude, bool negative,
+                                   int precision);
+    static BigNumber divideSmall(const BigNumber &left, uint64_t magnitude, bool negative,
+                                 int precision);
+
+    // Lazy expressions evaluate through the kernels above without truncating
+    friend class BigNumExpr::Evaluator;
+    // Modular arithmetic and gcd work on the limbs of integers directly
+    friend class BigNumFn::ModContext;
+    friend BigNumber BigNumFn::gcd(const BigNumber &a, const BigNumber &b);
+    // Powers of a mantissa of 1, 2 or 5 are built from the exponent
+    friend BigNumber BigNumFn::intPow(const BigNumber &base, int64_t exponent);
 
 public:
     bool isInt() const;
@@ -49,9 +119,18 @@ public:
     BigNumber truncate(int precision) const;
     BigNumber round(int precision) const;
     bool isOdd() const;
+    int64_t orderOfMagnitude() const;
+    // |*this| mod `magnitude` for an integer, in a machine word
+    uint64_t remainderSmall(uint64_t magnitude) const;
+    BigNumber scaleByPowerOfTen(int64_t power) const;
+    // Same as *this * *this, which also squares, but says so at the call site
+    BigNumber square() const;
 
-    BigNumber operator+(const BigNumber &other) const;
-    BigNumber operator-(const BigNumber &other) const;
+    // Sums reuse the buffer of whichever operand is a temporary
+    friend BigNumber operator+(BigNumber left, const BigNumber &right);
+    friend BigNumber operator+(const BigNumber &left, BigNumber &&right);
+    friend BigNumber operator-(BigNumber left, const BigNumber &right);
+    friend BigNumber operator-(const BigNumber &left, BigNumber &&right);
     BigNumber operator*(const BigNumber &other) const;
     BigNumber operator/(const BigNumber &other) const;
     BigNumber operator%(const BigNumber &other) const;
@@ -65,17 +144,77 @@ public:
 
     BigNumber &operator=(const std::string &str);
     BigNumber &operator+=(const BigNumber &other);
+    BigNumber &operator+=(BigNumber &&other);
     BigNumber &operator-=(const BigNumber &other);
+    BigNumber &operator-=(BigNumber &&other);
     BigNumber &operator*=(const BigNumber &other);
     BigNumber &operator/=(const BigNumber &other);
     BigNumber &operator%=(const BigNumber &other);
     BigNumber operator-() const;
 
+    // Same as the operators but truncated to `digits` digits after the
+    // decimal point instead of the thread's precision
+    static BigNumber add(const BigNumber &left, const BigNumber &right, int digits);
+    static BigNumber sub(const BigNumber &left, const BigNumber &right, int digits);
+    static BigNumber mul(const BigNumber &left, const BigNumber &right, int digits);
+    static BigNumber div(const BigNumber &left, const BigNumber &right, int digits);
+    static BigNumber scale(const BigNumber &x, int64_t power, int digits);
+
+    // Quotient of two integers truncated towards zero, the remainder takes
+    // the sign of `left` as with operator%
+    static BigNumber divMod(const BigNumber &left, const BigNumber &right, BigNumber &remainder);
+
+    // Products and quotients with a machine integer skip the conversion
+    // and the general kernels
+    template <typename T, IfInteger<T> = 0> BigNumber operator*(T other) const
+    {
+        return multiplySmall(*this, integerMagnitude(other), other < T(0), workingPrecision());
+    }
+    template <typename T, IfInteger<T> = 0> BigNumber operator/(T other) const
+    {
+        return divideSmall(*this, integerMagnitude(other), other < T(0), workingPrecision());
+    }
+    // Single pass over the limbs, the remainder takes the sign of *this as
+    // with operator%(const BigNumber &)
+    template <typename T, IfInteger<T> = 0> BigNumber operator%(T other) const
+    {
+        BigNumber res = remainderSmall(integerMagnitude(other));
+        return _isNegative ? -res : res;
+    }
+    template <typename T, IfInteger<T> = 0> friend BigNumber operator*(T left, const BigNumber &right)
+    {
+        return right * left;
+    }
+    template <typename T, IfInteger<T> = 0> BigNumber &operator*=(T other)
+    {
+        return *this = *this * other;
+    }
+    template <typename T, IfInteger<T> = 0> BigNumber &operator/=(T other)
+    {
+        return *this = *this / other;
+    }
+    template <typename T, IfInteger<T> = 0>
+    static BigNumber mul(const BigNumber &left, T right, int digits)
+    {
+        return multiplySmall(left, integerMagnitude(right), right < T(0), checkedDigits(digits));
+    }
+    template <typename T, IfInteger<T> = 0>
+    static BigNumber div(const BigNumber &left, T right, int digits)
+    {
+        return divideSmall(left, integerMagnitude(right), right < T(0), checkedDigits(digits));
+    }
+
     static void setPrecision(int precision);
     static int getPrecision();
+    static PrecisionContext getPrecisionContext();
 
     BigNumber(const std::string &str);
     BigNumber(double num);
+    // Exact, unlike the conversion through double
+    template <typename T, IfInteger<T> = 0> BigNumber(T num)
+    {
+        assignInteger(integerMagnitude(num), num < T(0));
+    }
     BigNumber();
     std::string toString();
 };
@@ -1,4 +1,6 @@
+#include "bigNumExpr.h"
 #include "bigNumFn.h"
+#include "bigNumMod.h"
 #include "bigNumber.h"
 #include <algorithm>
 #include <array>
@@ -11,6 +13,7 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <thread>
 
 #define TEST_OP(a, op, b, res) assert(BigNumber(#a) op BigNumber(#b) == BigNumber(#res))
 #define TEST_METHOD(a, method, res) assert(BigNumber(#a).method == BigNumber(#res));
@@ -148,6 +151,53 @@ int main()
 
 #pragma endregion
 
+#pragma region Compound assignment
+
+    {
+        BigNumber acc("12.5");
+        acc += acc;
+        assert(acc == BigNumber("25"));
+        acc -= BigNumber("25.000001");
+        assert(acc == BigNumber("-0.000001"));
+        acc -= acc;
+        assert(acc == BigNumber("0") && !acc.isNegative());
+
+        // temporaries on either side
+        assert(BigNumber("1.5") - (BigNumber("0.25") + BigNumber("2")) == BigNumber("-0.75"));
+        assert((BigNumber("7") * BigNumber("3")) - BigNumber("0.5") == BigNumber("20.5"));
+    }
+
+#pragma endregion
+
+#pragma region Lazy expressions
+
+    {
+        using BigNumExpr::lazy;
+
+        BigNumber a("8713902.317381273"), b("13.318380013"), c("0.5");
+        BigNumber r = lazy(a) * b - c;
+        assert(r == BigNumber("116055061.959045128823696549"));
+        r = lazy(a) * 2 + lazy(b) / c;
+        assert(r == BigNumber("17427831.271522572"));
+
+        // integer literals above 2^53 are not rounded through double
+        BigNumber three(3);
+        const int64_t k = 100000000000000001;
+        r = lazy(three) * k;
+        assert(r == three * k && r == BigNumber("300000000000000003"));
+        r = k - lazy(three);
+        assert(r == BigNumber("99999999999999998"));
+
+        // only the final result is truncated
+        BigNumber small = BigNumber("1").scaleByPowerOfTen(-60);
+        BigNumber large = BigNumber("1").scaleByPowerOfTen(120);
+        assert(small * small * large == BigNumber("0"));
+        r = lazy(small) * small * large;
+        assert(r == BigNumber("1"));
+    }
+
+#pragma endregion
+
 #pragma region Multiplication
     TEST_OP(38, *, 108, 4104.0);
     TEST_OP(38, *, -108, -4104.0);
@@ -155,6 +205,52 @@ int main()
     TEST_OP(0, *, 888.888, 0.0);
     TEST_OP(0.00238, *, 1315.55, 3.131009);
 
+    {
+        // long enough to go through Karatsuba, balanced and unbalanced
+        BigNumber nines(string(3000, '9'));
+        BigNumber shortNines(string(1300, '9'));
+        assert(nines * nines == BigNumber(string(2999, '9') + "8" + string(2999, '0') + "1"));
+        assert(nines * shortNines ==
+               BigNumber(string(1299, '9') + "8" + string(1700, '9') + string(1299, '0') + "1"));
+
+        string digits;
+        for (int i = 0; i < 250; i++)
+            digits += to_string(i * 7919 % 100000);
+        BigNumber x(digits), y(digits.substr(0, 1500) + ".25");
+        assert((x * y) / y == x);
+
+        // squares against products of two distinct copies
+        BigNumber xCopy = x;
+        assert(x.square() == x * xCopy);
+        assert(x * x == x * xCopy);
+        TEST_METHOD(-1.5, square(), 2.25);
+    }
+
+    {
+        // Toom-3/2, Toom-3 and Toom-4 sizes
+        string digits;
+        for (int i = 0; i < 9000; i++)
+            digits += to_string(i * 7919 % 100000);
+        BigNumber x(digits.substr(0, 40000)), y(digits.substr(3, 40000)), z(digits.substr(5, 26000));
+        assert(x * (y + z) == x * y + x * z);
+        assert(z * (x - y) == z * x - z * y);
+
+        BigNumber nines(string(20000, '9'));
+        assert(nines * (nines + 2) == BigNumber(string(40000, '9')));
+        assert(x.square() == x * BigNumber(x));
+
+        // number theoretic transform
+        for (int i = 9000; i < 12000; i++)
+            digits += to_string(i * 7919 % 100000);
+        BigNumber u(digits.substr(0, 52000)), v(digits.substr(7, 50000));
+        assert(u * (v + x) == u * v + u * x);
+        assert((u + nines) * v == u * v + nines * v);
+
+        BigNumber longNines(string(50000, '9'));
+        assert(longNines * (longNines + 2) == BigNumber(string(100000, '9')));
+        assert(u.square() == u * BigNumber(u));
+    }
+
 #pragma endregion
 
 #pragma region Factorial
@@ -180,6 +276,21 @@ int main()
     //        "6859296389521759999322991560894146397615651828625369792"
     //        "0827223758251185210916864000000000000000000000000.0");
 
+    assert(BigNumFn::factorial(0) == 1 && BigNumFn::factorial(10) == 3628800);
+    assert(BigNumFn::factorial(25) == BigNumber("15511210043330985984000000"));
+    assert(BigNumFn::factorial(20001) == BigNumFn::factorial(20000) * 20001);
+
+    assert(BigNumFn::binomial(52, 5) == 2598960 && BigNumFn::binomial(5, 6) == 0);
+    assert(BigNumFn::fallingFactorial(10, 3) == 720 && BigNumFn::fallingFactorial(3, 4) == 0);
+    assert(BigNumFn::multinomial({3, 3, 3}) == 1680);
+
+    // both the prime exponent and the plain product paths
+    assert(BigNumFn::binomial(20000, 10000) * BigNumFn::factorial(10000).square() ==
+           BigNumFn::factorial(20000));
+    assert(BigNumFn::binomial(100000, 3) == BigNumber("166661666700000"));
+    assert(BigNumFn::fallingFactorial(2000000000, 2) == BigNumber("3999999998000000000"));
+    assert(BigNumFn::multinomial({100000, 1, 2}) == BigNumFn::fallingFactorial(100003, 3) / 2);
+
 #pragma endregion
 
 #pragma region Division
@@ -192,6 +303,56 @@ int main()
     TEST_OP(3684549.96, /, -655.2, -5623.55);
     TEST_OP(3.131009, /, 0.00238, 1315.55);
 
+    // Newton reciprocal for long divisors
+    {
+        string digits;
+        for (int i = 1000; i < 4000; i++)
+            digits += to_string(i * 7919 % 10000);
+
+        BigNumber x(digits.substr(0, 9000)), y(digits.substr(11, 6000)), z(digits.substr(2, 5000));
+        assert(BigNumber::div(x * y, y, 0) == x);
+        assert(BigNumber::div(x * y + z, y, 0) == x);
+        assert(BigNumber::div(x * y - 1, y, 0) == x - 1);
+        assert(BigNumber::div(x, y, 0) * y + x % y == x);
+
+        BigNumber nines(string(3000, '9'));
+        assert(BigNumber::div(BigNumber(string(6000, '9')), nines, 0) == nines + 2);
+        assert(BigNumber::div(1, nines, 3010).scaleByPowerOfTen(3000) == 1);
+    }
+
+#pragma endregion
+
+#pragma region Machine integers
+
+    {
+        BigNumber x("8713902.317381273");
+        assert(x * 38 == x * BigNumber("38"));
+        assert(x * -108 == x * BigNumber("-108"));
+        assert(-3 * x == x * BigNumber("-3"));
+        assert(x / 7 == x / BigNumber("7"));
+        assert(x / -655 == x / BigNumber("-655"));
+        assert(x * 0 == 0 && !(x * 0).isNegative());
+
+        // exact beyond the 15 digits a double holds
+        assert(BigNumber(INT64_MIN) == BigNumber("-9223372036854775808"));
+        assert(BigNumber(UINT64_MAX) == BigNumber("18446744073709551615"));
+        assert(x * UINT64_MAX == x * BigNumber("18446744073709551615"));
+        assert(BigNumber::div(x, 3, 4) == BigNumber("2904634.1057"));
+
+        BigNumber y = x;
+        y *= 1000;
+        y /= -8;
+        assert(y == BigNumber("-1089237789.672659125"));
+
+        // remainders are BigNumbers with the sign of the dividend for every
+        // integer type
+        assert(BigNumber(-25) % int64_t(7) == -4);
+        assert(BigNumber(-25) % 7u == BigNumber(-4));
+        assert(BigNumber("-18446744073709551617") % UINT64_MAX == BigNumber(-2));
+        assert((BigNumber(-25) % 3).toString() == "-1.0" && (BigNumber(25) % 5) == BigNumber(0));
+        assert(BigNumber("-18446744073709551617").remainderSmall(UINT64_MAX) == 2);
+    }
+
 #pragma endregion
 
 #pragma region Truncate
@@ -231,6 +392,248 @@ int main()
     TEST_OP(25, %, 5, 0);
     TEST_OP(100, %, 101, 100);
     TEST_OP(123456789, %, 1000, 789);
+    TEST_OP(12000000000000000000000000000000, %, 7000000, 5000000);
+    // a quotient of ten million used to be taken by repeated subtraction
+    TEST_OP(999999999999999, %, 10000001, 9);
+    TEST_OP(-1000000000000000000000000000000000000000000000000000000000003, %,
+            100000000000000000000000000000000000000000000000000001, -99999999999999999999999999999999999999999999990000004);
+
+    {
+        BigNumber rem;
+        assert(BigNumber::divMod(BigNumber("-7"), BigNumber("3"), rem) == BigNumber("-2"));
+        assert(rem == BigNumber("-1"));
+        assert(BigNumber::divMod(BigNumber("7"), BigNumber("-3"), rem) == BigNumber("-2"));
+        assert(rem == BigNumber("1"));
+
+        // one divisor limb, several limbs and long enough for the reciprocal
+        BigNumber x("98765432109876543210987654321098765432109876543210");
+        BigNumber nines(string(2000, '9'));
+        for (const BigNumber &y : {BigNumber("1234567"), BigNumber("98765432109876543210123"),
+                                   nines - 12345})
+        {
+            BigNumber xy = x * y + 1234567;
+            BigNumber q = BigNumber::divMod(xy * xy, y, rem);
+            assert(q * y + rem == xy * xy && rem >= 0 && rem < y);
+        }
+    }
+#pragma endregion
+
+#pragma region Modular arithmetic
+
+    {
+        BigNumFn::ModContext mod(BigNumber("1000003"));
+        assert(mod.reduce(-17) == 999986);
+        assert(mod.mul(BigNumber("12345678901234567890"), BigNumber("98765432109876543210")) ==
+               239786);
+        assert(mod.square(1000002) == 1);
+
+        assert(BigNumFn::ModContext(1000000007).pow(3, BigNumber("1").scaleByPowerOfTen(20)) == 139421235);
+        assert(BigNumFn::ModContext(BigNumber("1000000000000000000000000000057"))
+                   .pow(7, BigNumber("18446744073709551617")) ==
+               BigNumber("859313747143570773243011866318"));
+
+        // Fermat's little theorem for the Mersenne prime 2^127 - 1
+        BigNumber mersenne("170141183460469231731687303715884105727");
+        assert(BigNumFn::modPower(BigNumber("12345678901234567890"), mersenne - 1, mersenne) == 1);
+        assert(BigNumFn::modPower(-2, 3, 5) == -3);
+        assert(BigNumFn::ModContext(1).pow(5, 0) == 0);
+
+        // fixed base powers agree with the sliding window, also past the table
+        BigNumFn::ModContext big(mersenne);
+        BigNumFn::FixedBasePower powersOf3(big, 3);
+        assert(powersOf3.pow(0) == 1);
+        assert(powersOf3.pow(mersenne - 1) == 1);
+        assert(powersOf3.pow(BigNumber("98765432109876543210")) ==
+               big.pow(3, BigNumber("98765432109876543210")));
+        assert(powersOf3.pow(mersenne * mersenne) == big.pow(3, mersenne * mersenne));
+    }
+
+#pragma endregion
+
+#pragma region Primes
+
+    assert(BigNumber("1000000000000000000000000000057") % 1000003 == 999817);
+    assert(BigNumber(-25) % 7 == -4);
+
+    assert(!BigNumFn::isPrime(1) && BigNumFn::isPrime(2) && BigNumFn::isPrime(997));
+    assert(!BigNumFn::isPrime(BigNumber("1000006000009"))); // 1000003^2
+    assert(BigNumFn::isPrime(BigNumber("170141183460469231731687303715884105727")));
+    // a strong pseudoprime to every prime base up to 37, the Lucas test rejects it
+    assert(!BigNumFn::isPrime(BigNumber("318665857834031151167461")));
+    // squares of the Wieferich primes pass base 2, the Lucas test finds no
+    // (D / n) = -1 for them and checks for a square instead
+    assert(!BigNumFn::isPrime(1093 * 1093) && !BigNumFn::isPrime(3511 * 3511));
+    assert(BigNumFn::isPrimeFerma(BigNumber("618970019642690137449562111"), 5));
+    assert(BigNumFn::nextPrime(BigNumber("100000000000000000000000000000")) ==
+           BigNumber("100000000000000000000000000319"));
+
+    {
+        vector<BigNumber> primes = BigNumFn::primesInRange(-5, 30);
+        assert(primes.size() == 10 && primes[0] == 2 && primes[9] == 29);
+
+        // the sieving primes themselves stay in, 65537 is one of them
+        primes = BigNumFn::primesInRange(65500, 65600);
+        assert(primes.size() == 12 && primes[2] == 65537 && primes[11] == 65599);
+
+        BigNumber from("100000000000000000000");
+        primes = BigNumFn::primesInRange(from, from + 1000);
+        assert(primes.size() == 24 && primes[0] == from + 39 && primes[23] == from + 993);
+    }
+
+#pragma endregion
+
+#pragma region Greatest common divisor
+
+    assert(BigNumFn::gcd(0, 0) == 0 && BigNumFn::gcd(7, 0) == 7 && BigNumFn::gcd(-12, 18) == 6);
+    assert(BigNumFn::gcd(BigNumber("1").scaleByPowerOfTen(40), BigNumber("25").scaleByPowerOfTen(30)) ==
+           BigNumber("25").scaleByPowerOfTen(30));
+
+    {
+        // consecutive Fibonacci numbers take the most Euclid steps
+        BigNumber previous = 0, last = 1;
+        for (int i = 0; i < 3000; i++)
+        {
+            previous += last;
+            swap(previous, last);
+        }
+        assert(BigNumFn::gcd(last, previous) == 1);
+        assert(BigNumFn::gcd(last * previous, previous * previous) == previous);
+    }
+
+#pragma endregion
+
+#pragma region Modular inverse and CRT
+
+    {
+        BigNumber x, y;
+        assert(BigNumFn::extendedGcd(240, -46, x, y) == 2 && x * 240 - y * 46 == 2);
+        assert(BigNumFn::modInverse(3, 7) == 5 && BigNumFn::modInverse(-3, 7) == 2);
+
+        // half-GCD sizes, 2^9689 - 1 is a Mersenne prime
+        BigNumber mersenne = BigNumFn::intPow(2, 9689) - 1;
+        BigNumber a = BigNumFn::intPow(3, 6000) + 1;
+        assert(BigNumFn::extendedGcd(mersenne, a, x, y) == 1 && x * mersenne + y * a == 1);
+        assert(BigNumFn::modInverse(a, mersenne) * a % mersenne == 1);
+
+        bool thrown = false;
+        try
+        {
+            BigNumFn::modInverse(6, 9);
+        }
+        catch (const invalid_argument &)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+
+        vector<BigNumber> residues = {2, 3, 2};
+        vector<BigNumber> moduli = {3, 5, 7};
+        assert(BigNumFn::crt(residues, moduli) == 23);
+    }
+
+#pragma endregion
+
+#pragma region Inline storage
+
+    // 76 digits fill the inline limbs, the carry spills to the heap and back
+    TEST_OP(9999999999999999999999999999999999999999999999999999999999999999999999999999, +, 1,
+            10000000000000000000000000000000000000000000000000000000000000000000000000000);
+    TEST_OP(10000000000000000000000000000000000000000000000000000000000000000000000000001, -, 2,
+            9999999999999999999999999999999999999999999999999999999999999999999999999999);
+
+#pragma endregion
+
+#pragma region Exponent
+
+    TEST_METHOD(12.5, scaleByPowerOfTen(3), 12500);
+    TEST_METHOD(0.0125, scaleByPowerOfTen(-2), 0.000125);
+    TEST_METHOD(-0.0125, scaleByPowerOfTen(0), -0.0125);
+
+    assert(BigNumFn::intPow(3, 40) == BigNumber("12157665459056928801"));
+    assert(BigNumFn::intPow(-2, 63) == BigNumber("-9223372036854775808"));
+    assert(BigNumFn::intPow(3, 20000) == BigNumFn::intPow(9, 10000));
+    assert(BigNumFn::intPow(4, -2) == BigNumber("0.0625"));
+    // powers of a mantissa of 1, 2 or 5 come from the exponent
+    assert(BigNumFn::intPow(-10, 100001) == -BigNumber("1").scaleByPowerOfTen(100001));
+    assert(BigNumFn::intPow(0.05, -50) == BigNumber("1125899906842624").scaleByPowerOfTen(50));
+    assert(BigNumber("1" + string(70000, '0')).orderOfMagnitude() == 70001);
+    assert((BigNumber("1" + string(70000, '0')) + BigNumber(1)).isOdd());
+    assert(BigNumFn::sqroot(BigNumber("0." + string(39, '0') + "1")).toString() ==
+           "0.00000000000000000001");
+    assert(BigNumFn::ln(BigNumber("1" + string(1000, '0'))).toString() ==
+           "2302."
+           "585092994045684017991454684364207601101488628772976033327900967572609677352480235997"
+           "205089598298342");
+
+    {
+        // more digits than the thread's precision on either side of the point
+        BigNumber root(string(25, '9') + "123456789" + string(100, '7') + "31415926535");
+        assert(BigNumFn::sqroot(root.square() + root * 2, 0) == root);
+        assert(BigNumFn::sqroot((root + 1).square(), 0) == root + 1);
+        assert(BigNumFn::sqroot(root.square(), 150) == root);
+
+        // ln(10^200 + 1) - ln(10^200) = 10^-200 - 10^-400 / 2 + ...
+        BigNumber big = BigNumber("1").scaleByPowerOfTen(200);
+        BigNumber diff = BigNumber::sub(BigNumFn::ln(big + 1, 300), BigNumFn::ln(big, 300), 300);
+        BigNumber expected = BigNumber::scale(1, -200, 300);
+        assert(BigNumber::sub(diff, expected, 300).abs() <= BigNumber::scale(1, -299, 300));
+    }
+
+#pragma endregion
+
+#pragma region Precision context
+
+    {
+        string third10 = "0.3333333333";
+        string third30 = "0." + string(30, '3');
+
+        {
+            BigNumber::PrecisionScope outer(30);
+            assert((BigNumber(1) / BigNumber(3)).toString() == third30);
+            {
+                BigNumber::PrecisionScope inner(10);
+                assert(BigNumber::getPrecision() == 10);
+                assert((BigNumber(1) / BigNumber(3)).toString() == third10);
+            }
+            assert(BigNumber::getPrecision() == 30);
+        }
+        assert(BigNumber::getPrecision() == 99);
+
+        // each thread keeps its own precision
+        string results[2];
+        int precisions[2] = {10, 30};
+        thread workers[2];
+        for (int i = 0; i < 2; i++)
+        {
+            workers[i] = thread(
+                [&results, &precisions, i]()
+                {
+                    BigNumber::PrecisionScope scope(precisions[i]);
+                    results[i] = BigNumFn::sqroot(BigNumber(1) / BigNumber(9)).toString();
+                });
+        }
+        for (int i = 0; i < 2; i++)
+            workers[i].join();
+
+        assert(results[0] == third10);
+        assert(results[1] == third30);
+        assert(BigNumber::getPrecisionContext().precision == 110);
+    }
+
+#pragma endregion
+
+#pragma region Explicit precision
+
+    assert(BigNumber::mul(BigNumber("1.23456"), BigNumber("2.5"), 2) == BigNumber("3.08"));
+    assert(BigNumber::div(BigNumber(1), BigNumber(3), 5) == BigNumber("0.33333"));
+    assert(BigNumber::add(BigNumber("0.129"), BigNumber("-0.0001"), 2) == BigNumber("0.12"));
+    assert(BigNumber::sub(BigNumber("1"), BigNumber("0.5"), 0) == BigNumber("0"));
+    assert(BigNumFn::sqroot(2, 10) == BigNumber("1.4142135623"));
+    assert(BigNumFn::sqroot(9.9, 5) == BigNumber("3.14642"));
+    assert(BigNumFn::sqroot(100000000, 3) == BigNumber("10000"));
+    assert(BigNumFn::ln(10, 20) == BigNumber("2.30258509299404568401"));
+    assert(BigNumFn::ln(BigNumber("0.5"), 4) == BigNumber("-0.6931"));
+
 #pragma endregion
 
 #pragma region required for test
@@ -254,6 +657,11 @@ int main()
            "111397692189140567046372728408531447761129459003373822311973345385656456165709076833220"
            "769881585879");
 
+    assert(BigNumFn::chudnovskyPI(100) ==
+           BigNumber("3.1415926535897932384626433832795028841971693993751058209749445923078164062862089"
+                     "986280348253421170680"));
+    assert(BigNumFn::chudnovskyPI(10000).scaleByPowerOfTen(10000) % 1000000 == 375679);
+
 #pragma endregion
 
 #pragma region sqroot
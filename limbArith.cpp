@@ -0,0 +1,785 @@
+#include "limbArith.h"
+#include "limbBuffer.h"
+#include <algorithm>
+#include <vector>
+
+namespace LimbArith
+{
+    const uint64_t POW10[BASE_DIGITS + 1] = {1ULL,
+                                             10ULL,
+                                             100ULL,
+                                             1000ULL,
+                                             10000ULL,
+                                             100000ULL,
+                                             1000000ULL,
+                                             10000000ULL,
+                                             100000000ULL,
+                                             1000000000ULL,
+                                             10000000000ULL,
+                                             100000000000ULL,
+                                             1000000000000ULL,
+                                             10000000000000ULL,
+                                             100000000000000ULL,
+                                             1000000000000000ULL,
+                                             10000000000000000ULL,
+                                             100000000000000000ULL,
+                                             1000000000000000000ULL,
+                                             10000000000000000000ULL};
+
+    int digitCount(uint64_t limb)
+    {
+        int count = 0;
+        while (count < BASE_DIGITS && limb >= POW10[count])
+            count++;
+        return count;
+    }
+
+    int trailingZeroes(uint64_t limb)
+    {
+        int count = 0;
+        while (limb % 10 == 0)
+        {
+            limb /= 10;
+            count++;
+        }
+        return count;
+    }
+
+    int compare(const uint64_t *a, size_t na, const uint64_t *b, size_t nb)
+    {
+        if (na != nb)
+            return na < nb ? -1 : 1;
+
+        for (size_t i = na; i-- > 0;)
+        {
+            if (a[i] != b[i])
+                return a[i] < b[i] ? -1 : 1;
+        }
+        return 0;
+    }
+
+    uint64_t add(uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b, size_t nb)
+    {
+        uint64_t carry = 0;
+        size_t i = 0;
+
+        // Carries are taken without branching, random limbs make them
+        // impossible to predict
+        for (; i < nb; i++)
+        {
+            uint64_t s = a[i] + carry;
+            uint64_t t = s + b[i];
+
+            // t might have wrapped around 2^64, in which case it is
+            // still >= BASE and subtracting BASE fixes it up
+            carry = (t < s) | (t >= BASE);
+            r[i] = t - (BASE & (0 - carry));
+        }
+        for (; i < na; i++)
+        {
+            uint64_t t = a[i] + carry;
+            if (t >= BASE)
+            {
+                t -= BASE;
+                carry = 1;
+            }
+            else
+                carry = 0;
+            r[i] = t;
+        }
+        return carry;
+    }
+
+    void sub(uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b, size_t nb)
+    {
+        uint64_t borrow = 0;
+        size_t i = 0;
+
+        for (; i < nb; i++)
+        {
+            uint64_t toSubtract = b[i] + borrow;
+            uint64_t ai = a[i];
+
+            borrow = ai < toSubtract;
+            r[i] = ai - toSubtract + (BASE & (0 - borrow));
+        }
+        for (; i < na; i++)
+        {
+            if (a[i] < borrow)
+            {
+                r[i] = BASE - 1;
+            }
+            else
+            {
+                r[i] = a[i] - borrow;
+                borrow = 0;
+            }
+        }
+    }
+
+    uint64_t mulSmall(uint64_t *r, const uint64_t *a, size_t na, uint64_t m)
+    {
+        uint64_t carry = 0;
+
+        for (size_t i = 0; i < na; i++)
+        {
+            uint128 t = (uint128)a[i] * m + carry;
+            carry = divBase((uint64_t)(t >> 64), (uint64_t)t, r[i]);
+        }
+        return carry;
+    }
+
+    uint64_t divSmall(uint64_t *q, const uint64_t *a, size_t na, uint64_t d)
+    {
+        uint64_t rem = 0;
+
+        for (size_t i = na; i-- > 0;)
+        {
+            uint128 cur = (uint128)rem * BASE + a[i];
+            q[i] = (uint64_t)(cur / d);
+            rem = (uint64_t)(cur % d);
+        }
+        return rem;
+    }
+
+    size_t shiftedSize(const uint64_t *b, size_t nb, size_t limbs, int rest)
+    {
+        bool extraLimb = rest != 0 && b[nb - 1] >= POW10[BASE_DIGITS - rest];
+
+        return nb + limbs + (extraLimb ? 1 : 0);
+    }
+
+    int compareShifted(const uint64_t *a, size_t na, const uint64_t *b, size_t nb, size_t limbs,
+                       int rest)
+    {
+        size_t nbShifted = nb ? shiftedSize(b, nb, limbs, rest) : 0;
+
+        if (na != nbShifted)
+            return na < nbShifted ? -1 : 1;
+
+        for (size_t i = na; i-- > 0;)
+        {
+            uint64_t limb = shiftedLimb(b, nb, limbs, rest, i);
+            if (a[i] != limb)
+                return a[i] < limb ? -1 : 1;
+        }
+        return 0;
+    }
+
+    uint64_t addShifted(uint64_t *r, size_t nr, const uint64_t *b, size_t nb, size_t limbs,
+                        int rest)
+    {
+        uint64_t shiftCarry = 0;
+        uint64_t carry = 0;
+        size_t i = limbs;
+
+        for (size_t j = 0; (j < nb || shiftCarry) && i < nr; j++, i++)
+        {
+            uint64_t limb = shiftCarry;
+            shiftCarry = 0;
+
+            if (j < nb)
+            {
+                uint128 t = (uint128)b[j] * POW10[rest] + limb;
+                shiftCarry = divBase((uint64_t)(t >> 64), (uint64_t)t, limb);
+            }
+
+            uint64_t s = r[i] + carry;
+            uint64_t t = s + limb;
+            if (t < s || t >= BASE)
+            {
+                t -= BASE;
+                carry = 1;
+            }
+            else
+                carry = 0;
+            r[i] = t;
+        }
+        for (; carry && i < nr; i++)
+        {
+            if (++r[i] == BASE)
+                r[i] = 0;
+            else
+                carry = 0;
+        }
+        return carry;
+    }
+
+    void subShifted(uint64_t *r, size_t nr, const uint64_t *b, size_t nb, size_t limbs, int rest)
+    {
+        uint64_t shiftCarry = 0;
+        uint64_t borrow = 0;
+        size_t i = limbs;
+
+        for (size_t j = 0; (j < nb || shiftCarry) && i < nr; j++, i++)
+        {
+            uint64_t limb = shiftCarry;
+            shiftCarry = 0;
+
+            if (j < nb)
+            {
+                uint128 t = (uint128)b[j] * POW10[rest] + limb;
+                shiftCarry = divBase((uint64_t)(t >> 64), (uint64_t)t, limb);
+            }
+
+            uint64_t toSubtract = limb + borrow;
+            if (r[i] < toSubtract)
+            {
+                r[i] = r[i] + (BASE - toSubtract);
+                borrow = 1;
+            }
+            else
+            {
+                r[i] -= toSubtract;
+                borrow = 0;
+            }
+        }
+        for (; borrow && i < nr; i++)
+        {
+            if (r[i] == 0)
+                r[i] = BASE - 1;
+            else
+            {
+                r[i]--;
+                borrow = 0;
+            }
+        }
+    }
+
+    void subFromShifted(uint64_t *r, size_t nr, const uint64_t *b, size_t nb, size_t limbs,
+                        int rest)
+    {
+        uint64_t shiftCarry = 0;
+        uint64_t borrow = 0;
+
+        for (size_t i = 0; i < nr; i++)
+        {
+            uint64_t limb = 0;
+
+            if (i >= limbs)
+            {
+                size_t j = i - limbs;
+
+                limb = shiftCarry;
+                shiftCarry = 0;
+
+                if (j < nb)
+                {
+                    uint128 t = (uint128)b[j] * POW10[rest] + limb;
+                    shiftCarry = divBase((uint64_t)(t >> 64), (uint64_t)t, limb);
+                }
+            }
+
+            uint64_t toSubtract = r[i] + borrow;
+            if (limb < toSubtract)
+            {
+                r[i] = limb + (BASE - toSubtract);
+                borrow = 1;
+            }
+            else
+            {
+                r[i] = limb - toSubtract;
+                borrow = 0;
+            }
+        }
+    }
+
+    // Sums each column of partial products in a three word accumulator and
+    // reduces it by BASE once per column instead of once per product
+    void mulSchoolbook(uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b, size_t nb)
+    {
+        uint128 carry = 0;
+
+        for (size_t c = 0; c < na + nb; c++)
+        {
+            uint128 acc = carry;
+            uint64_t hi = 0;
+
+            size_t first = c >= nb ? c - nb + 1 : 0;
+            size_t last = c < na ? c + 1 : na;
+            for (size_t i = first; i < last; i++)
+            {
+                uint128 p = (uint128)a[i] * b[c - i];
+                acc += p;
+                hi += acc < p;
+            }
+
+            // hi * 2^128 + acc = q * BASE + r[c], hi < BASE
+            uint64_t rem;
+            uint64_t qHigh = divBase(hi, (uint64_t)(acc >> 64), rem);
+            uint64_t qLow = divBase(rem, (uint64_t)acc, r[c]);
+            carry = ((uint128)qHigh << 64) | qLow;
+        }
+    }
+
+    // Each product a[i] * a[j] with i != j appears twice in its column, so
+    // it is summed once and the column is doubled
+    void sqrSchoolbook(uint64_t *r, const uint64_t *a, size_t n)
+    {
+        uint128 carry = 0;
+
+        for (size_t c = 0; c < 2 * n; c++)
+        {
+            uint128 acc = 0;
+            uint64_t hi = 0;
+
+            size_t first = c >= n ? c - n + 1 : 0;
+            for (size_t i = first; 2 * i < c; i++)
+            {
+                uint128 p = (uint128)a[i] * a[c - i];
+                acc += p;
+                hi += acc < p;
+            }
+
+            hi = (hi << 1) | (uint64_t)(acc >> 127);
+            acc <<= 1;
+
+            if (c % 2 == 0 && c / 2 < n)
+            {
+                uint128 p = (uint128)a[c / 2] * a[c / 2];
+                acc += p;
+                hi += acc < p;
+            }
+            acc += carry;
+            hi += acc < carry;
+
+            uint64_t rem;
+            uint64_t qHigh = divBase(hi, (uint64_t)(acc >> 64), rem);
+            uint64_t qLow = divBase(rem, (uint64_t)acc, r[c]);
+            carry = ((uint128)qHigh << 64) | qLow;
+        }
+    }
+
+    // Karatsuba works on n = h + k limbs with h = n / 2 and k = n - h:
+    // a = a1 * BASE^h + a0 and b = b1 * BASE^h + b0, so that
+    // a * b = z2 * BASE^2h + (z0 + z2 + (a0 - a1)(b1 - b0)) * BASE^h + z0
+    // Scratch holds |a0 - a1|, |b1 - b0|, their product, the middle term and
+    // the scratch of the recursive calls
+
+    size_t karatsubaScratchSize(size_t n)
+    {
+        if (n < KARATSUBA_THRESHOLD)
+            return 0;
+
+        size_t k = n - n / 2;
+        return 6 * k + 1 + karatsubaScratchSize(k);
+    }
+
+    // Squaring needs no |b1 - b0| and the middle term is always
+    // z0 + z2 - (a0 - a1)^2
+    size_t sqrKaratsubaScratchSize(size_t n)
+    {
+        if (n < SQR_KARATSUBA_THRESHOLD)
+            return 0;
+
+        size_t k = n - n / 2;
+        return 5 * k + 1 + sqrKaratsubaScratchSize(k);
+    }
+
+    size_t sqrScratchSize(size_t n)
+    {
+        if (n >= TOOM3_THRESHOLD)
+            return 0;
+        return sqrKaratsubaScratchSize(n);
+    }
+
+    size_t mulScratchSize(size_t na, size_t nb)
+    {
+        if (na < nb)
+            return mulScratchSize(nb, na);
+        if (nb < KARATSUBA_THRESHOLD)
+            return 0;
+        // Toom and NTT keep their temporaries in buffers of their own
+        if (nb >= NTT_THRESHOLD || (na < 2 * nb && nb >= TOOM3_THRESHOLD))
+            return 0;
+        if (na == nb)
+            return std::max(karatsubaScratchSize(nb), sqrKaratsubaScratchSize(nb));
+
+        size_t size = mulScratchSize(nb, nb);
+        if (na % nb)
+            size = std::max(size, mulScratchSize(nb, na % nb));
+        return 2 * nb + size;
+    }
+
+    namespace
+    {
+        // r = |a - b| padded to n limbs, returns true if a < b
+        bool absDiff(uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b, size_t nb,
+                     size_t n)
+        {
+            while (na > 0 && a[na - 1] == 0)
+                na--;
+            while (nb > 0 && b[nb - 1] == 0)
+                nb--;
+
+            bool negative = compare(a, na, b, nb) < 0;
+            if (negative)
+            {
+                sub(r, b, nb, a, na);
+                std::fill(r + nb, r + n, 0);
+            }
+            else
+            {
+                sub(r, a, na, b, nb);
+                std::fill(r + na, r + n, 0);
+            }
+            return negative;
+        }
+    }
+
+    void mulKaratsuba(uint64_t *r, const uint64_t *a, const uint64_t *b, size_t n,
+                      uint64_t *scratch)
+    {
+        if (n < KARATSUBA_THRESHOLD)
+        {
+            mulSchoolbook(r, a, n, b, n);
+            return;
+        }
+
+        size_t h = n / 2;
+        size_t k = n - h;
+
+        uint64_t *da = scratch;
+        uint64_t *db = da + k;
+        uint64_t *t = db + k;
+        uint64_t *mid = t + 2 * k;
+        uint64_t *next = mid + 2 * k + 1;
+
+        mulKaratsuba(r, a, b, h, next);
+        mulKaratsuba(r + 2 * h, a + h, b + h, k, next);
+
+        bool negative = absDiff(da, a, h, a + h, k, k) != absDiff(db, b + h, k, b, h, k);
+        mulKaratsuba(t, da, db, k, next);
+
+        // mid = z2 + z0 -+ |a0 - a1| * |b1 - b0|, which is never negative
+        mid[2 * k] = add(mid, r + 2 * h, 2 * k, r, 2 * h);
+        if (negative)
+            sub(mid, mid, 2 * k + 1, t, 2 * k);
+        else
+            mid[2 * k] += add(mid, mid, 2 * k, t, 2 * k);
+
+        add(r + h, r + h, h + 2 * k, mid, 2 * k + 1);
+    }
+
+    void sqrKaratsuba(uint64_t *r, const uint64_t *a, size_t n, uint64_t *scratch)
+    {
+        if (n < SQR_KARATSUBA_THRESHOLD)
+        {
+            sqrSchoolbook(r, a, n);
+            return;
+        }
+
+        size_t h = n / 2;
+        size_t k = n - h;
+
+        uint64_t *da = scratch;
+        uint64_t *t = da + k;
+        uint64_t *mid = t + 2 * k;
+        uint64_t *next = mid + 2 * k + 1;
+
+        sqrKaratsuba(r, a, h, next);
+        sqrKaratsuba(r + 2 * h, a + h, k, next);
+
+        absDiff(da, a, h, a + h, k, k);
+        sqrKaratsuba(t, da, k, next);
+
+        mid[2 * k] = add(mid, r + 2 * h, 2 * k, r, 2 * h);
+        sub(mid, mid, 2 * k + 1, t, 2 * k);
+
+        add(r + h, r + h, h + 2 * k, mid, 2 * k + 1);
+    }
+
+    namespace
+    {
+        // Sign and magnitude number used for the Toom evaluations, which
+        // can go negative
+        struct SignedLimbs
+        {
+            LimbBuffer limbs;
+            bool negative = false;
+
+            void assign(const uint64_t *a, size_t na)
+            {
+                while (na > 0 && a[na - 1] == 0)
+                    na--;
+                limbs.assign(a, a + na);
+                negative = false;
+            }
+
+            void normalize()
+            {
+                while (!limbs.empty() && limbs.back() == 0)
+                    limbs.pop_back();
+                if (limbs.empty())
+                    negative = false;
+            }
+        };
+
+        // x += other, or x -= other if `subtract` is set
+        void addSigned(SignedLimbs &x, const SignedLimbs &other, bool subtract)
+        {
+            bool otherNegative = other.negative != subtract;
+            size_t nx = x.limbs.size();
+            size_t no = other.limbs.size();
+
+            if (x.negative == otherNegative)
+            {
+                x.limbs.resize(std::max(nx, no) + 1);
+                uint64_t *r = x.limbs.data();
+                if (nx >= no)
+                    r[nx] = add(r, r, nx, other.limbs.data(), no);
+                else
+                    r[no] = add(r, other.limbs.data(), no, r, nx);
+            }
+            else if (compare(x.limbs.data(), nx, other.limbs.data(), no) >= 0)
+            {
+                sub(x.limbs.data(), x.limbs.data(), nx, other.limbs.data(), no);
+            }
+            else
+            {
+                x.limbs.resize(no);
+                sub(x.limbs.data(), other.limbs.data(), no, x.limbs.data(), nx);
+                x.negative = otherNegative;
+            }
+            x.normalize();
+        }
+
+        // x *= m, requires |m| < BASE
+        void mulSmallSigned(SignedLimbs &x, int64_t m)
+        {
+            size_t n = x.limbs.size();
+
+            x.limbs.resize(n + 1);
+            x.limbs[n] = mulSmall(x.limbs.data(), x.limbs.data(), n, m < 0 ? -m : m);
+            if (m < 0)
+                x.negative = !x.negative;
+            x.normalize();
+        }
+
+        // x /= d where d divides x, d may be negative
+        void divExactSigned(SignedLimbs &x, int64_t d)
+        {
+            divSmall(x.limbs.data(), x.limbs.data(), x.limbs.size(), d < 0 ? -d : d);
+            if (d < 0)
+                x.negative = !x.negative;
+            x.normalize();
+        }
+
+        // Toom points other than infinity, in the order they are taken
+        const int64_t TOOM_POINTS[] = {0, 1, -1, 2, -2, 3, -3};
+    }
+
+    // Toom-Cook with a split into `ka` and b into `kb` pieces of k limbs:
+    // both polynomials are evaluated at ka + kb - 1 points, multiplied
+    // pointwise and the product is interpolated back. The value at infinity
+    // is the product of the leading pieces, the rest is recovered by Newton
+    // divided differences, which are exact divisions for integer polynomials
+    void mulToom(uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b, size_t nb, int ka,
+                 int kb)
+    {
+        size_t k = std::max((na + ka - 1) / ka, (nb + kb - 1) / kb);
+        int points = ka + kb - 1;
+        bool square = a == b && na == nb && ka == kb;
+        int finite = points - 1;
+
+        // Evaluates the pieces of x at `point` by Horner's rule
+        auto evaluate = [k](SignedLimbs &res, const uint64_t *x, size_t nx, int pieces,
+                            int64_t point)
+        {
+            res.limbs.clear();
+            res.negative = false;
+            for (int i = pieces; i-- > 0;)
+            {
+                size_t start = std::min(i * k, nx);
+                size_t end = std::min(start + k, nx);
+                SignedLimbs piece;
+                piece.assign(x + start, end - start);
+
+                mulSmallSigned(res, point);
+                addSigned(res, piece, false);
+            }
+        };
+
+        auto multiply = [](SignedLimbs &res, const SignedLimbs &x, const SignedLimbs &y)
+        {
+            res.limbs.clear();
+            res.negative = false;
+            if (x.limbs.empty() || y.limbs.empty())
+                return;
+
+            res.limbs.resize(x.limbs.size() + y.limbs.size());
+            if (&x == &y)
+                sqr(res.limbs.data(), x.limbs.data(), x.limbs.size());
+            else
+                mul(res.limbs.data(), x.limbs.data(), x.limbs.size(), y.limbs.data(),
+                    y.limbs.size());
+            res.negative = x.negative != y.negative;
+            res.normalize();
+        };
+
+        // Value at infinity
+        SignedLimbs top, ea, eb;
+        {
+            size_t aStart = (ka - 1) * k;
+            size_t bStart = (kb - 1) * k;
+            ea.assign(a + aStart, aStart < na ? na - aStart : 0);
+            eb.assign(b + bStart, bStart < nb ? nb - bStart : 0);
+            multiply(top, ea, square ? ea : eb);
+        }
+
+        // Values at the finite points with the top term taken out, so that
+        // they belong to a polynomial of degree finite - 1
+        std::vector<SignedLimbs> d(finite);
+        for (int i = 0; i < finite; i++)
+        {
+            int64_t point = TOOM_POINTS[i];
+            evaluate(ea, a, na, ka, point);
+            if (!square)
+                evaluate(eb, b, nb, kb, point);
+            multiply(d[i], ea, square ? ea : eb);
+
+            int64_t power = 1;
+            for (int j = 0; j < finite; j++)
+                power *= point;
+
+            SignedLimbs term = top;
+            mulSmallSigned(term, power);
+            addSigned(d[i], term, true);
+        }
+
+        // Divided differences, d[i] becomes f[x_0, ..., x_i]
+        for (int j = 1; j < finite; j++)
+        {
+            for (int i = finite - 1; i >= j; i--)
+            {
+                addSigned(d[i], d[i - 1], true);
+                divExactSigned(d[i], TOOM_POINTS[i] - TOOM_POINTS[i - j]);
+            }
+        }
+
+        // Newton form to coefficients:
+        // c = d[finite - 1], then c = c * (x - x_i) + d[i] down to i = 0
+        std::vector<SignedLimbs> c(points);
+        c[0] = d[finite - 1];
+        for (int i = finite - 1; i-- > 0;)
+        {
+            int degree = finite - 1 - i;
+            for (int j = degree; j > 0; j--)
+            {
+                SignedLimbs term = c[j];
+                mulSmallSigned(term, TOOM_POINTS[i]);
+                c[j] = c[j - 1];
+                addSigned(c[j], term, true);
+            }
+            mulSmallSigned(c[0], -TOOM_POINTS[i]);
+            addSigned(c[0], d[i], false);
+        }
+        c[finite] = top;
+
+        // Every coefficient of the product is a sum of products of pieces,
+        // so none of them is negative
+        std::fill(r, r + na + nb, 0);
+        for (int i = 0; i < points; i++)
+        {
+            size_t offset = i * k;
+            size_t size = c[i].limbs.size();
+
+            if (size)
+                add(r + offset, r + offset, na + nb - offset, c[i].limbs.data(), size);
+        }
+    }
+
+    void mul(uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b, size_t nb,
+             uint64_t *scratch)
+    {
+        if (na < nb)
+        {
+            mul(r, b, nb, a, na, scratch);
+            return;
+        }
+        if (a == b && na == nb)
+        {
+            sqr(r, a, na, scratch);
+            return;
+        }
+        if (nb < KARATSUBA_THRESHOLD)
+        {
+            mulSchoolbook(r, a, na, b, nb);
+            return;
+        }
+        if (nb >= NTT_THRESHOLD)
+        {
+            mulNtt(r, a, na, b, nb);
+            return;
+        }
+        if (na < 2 * nb && nb >= TOOM3_THRESHOLD)
+        {
+            // Toom-3/2 fits operands in a 3:2 ratio best
+            if (4 * na >= 5 * nb)
+                mulToom(r, a, na, b, nb, 3, 2);
+            else if (nb >= TOOM4_THRESHOLD)
+                mulToom(r, a, na, b, nb, 4, 4);
+            else
+                mulToom(r, a, na, b, nb, 3, 3);
+            return;
+        }
+        if (na == nb)
+        {
+            mulKaratsuba(r, a, b, nb, scratch);
+            return;
+        }
+
+        // Unbalanced operands are cut into nb limb pieces of a
+        uint64_t *piece = scratch;
+        uint64_t *next = scratch + 2 * nb;
+        size_t offset = 0;
+
+        std::fill(r, r + na + nb, 0);
+        for (; offset + nb <= na; offset += nb)
+        {
+            mul(piece, a + offset, nb, b, nb, next);
+            add(r + offset, r + offset, na + nb - offset, piece, 2 * nb);
+        }
+        if (offset < na)
+        {
+            mul(piece, b, nb, a + offset, na - offset, next);
+            add(r + offset, r + offset, na + nb - offset, piece, na + nb - offset);
+        }
+    }
+
+    void mul(uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b, size_t nb)
+    {
+        if (a == b && na == nb)
+        {
+            sqr(r, a, na);
+            return;
+        }
+
+        LimbBuffer scratch;
+        scratch.resize(mulScratchSize(na, nb));
+
+        mul(r, a, na, b, nb, scratch.data());
+    }
+
+    void sqr(uint64_t *r, const uint64_t *a, size_t n, uint64_t *scratch)
+    {
+        if (n < SQR_KARATSUBA_THRESHOLD)
+            sqrSchoolbook(r, a, n);
+        else if (n >= NTT_THRESHOLD)
+            mulNtt(r, a, n, a, n);
+        else if (n >= TOOM4_THRESHOLD)
+            mulToom(r, a, n, a, n, 4, 4);
+        else if (n >= TOOM3_THRESHOLD)
+            mulToom(r, a, n, a, n, 3, 3);
+        else
+            sqrKaratsuba(r, a, n, scratch);
+    }
+
+    void sqr(uint64_t *r, const uint64_t *a, size_t n)
+    {
+        LimbBuffer scratch;
+        scratch.resize(sqrScratchSize(n));
+
+        sqr(r, a, n, scratch.data());
+    }
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Kernels working on raw little-endian arrays of base 10^19 limbs
+namespace LimbArith
+{
+    __extension__ typedef unsigned __int128 uint128;
+
+    const uint64_t BASE = 10000000000000000000ULL;
+    const int BASE_DIGITS = 19;
+
+    // floor((2^128 - 1) / BASE) - 2^64, BASE already has its top bit set
+    const uint64_t BASE_INV = 15581492618384294730ULL;
+
+    // POW10[i] = 10^i for i in [0; 19]
+    extern const uint64_t POW10[BASE_DIGITS + 1];
+
+    // Divides hi * 2^64 + lo by BASE, requires hi < BASE
+    // Moller & Granlund, "Improved division by invariant integers"
+    inline uint64_t divBase(uint64_t hi, uint64_t lo, uint64_t &rem)
+    {
+        uint128 q = (uint128)BASE_INV * hi + (((uint128)hi << 64) | lo);
+        uint64_t q1 = (uint64_t)(q >> 64) + 1;
+        uint64_t q0 = (uint64_t)q;
+        uint64_t r = lo - q1 * BASE;
+
+        if (r > q0)
+        {
+            q1--;
+            r += BASE;
+        }
+        if (r >= BASE)
+        {
+            q1++;
+            r -= BASE;
+        }
+        rem = r;
+        return q1;
+    }
+
+    // Number of decimal digits in a single limb (0 has zero digits)
+    int digitCount(uint64_t limb);
+
+    // Number of trailing decimal zeroes of a non-zero limb
+    int trailingZeroes(uint64_t limb);
+
+    // Returns -1, 0 or 1, arrays must not have leading zero limbs
+    int compare(const uint64_t *a, size_t na, const uint64_t *b, size_t nb);
+
+    // r = a + b, requires na >= nb, returns the carry out of r[na - 1]
+    uint64_t add(uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b, size_t nb);
+
+    // r = a - b, requires a >= b and na >= nb
+    void sub(uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b, size_t nb);
+
+    // r = a * m, requires m < BASE, returns the carry out of r[na - 1]
+    uint64_t mulSmall(uint64_t *r, const uint64_t *a, size_t na, uint64_t m);
+
+    // q = a / d, requires 0 < d < BASE, returns the remainder
+    uint64_t divSmall(uint64_t *q, const uint64_t *a, size_t na, uint64_t d);
+
+    // The functions below take b shifted left by `limbs` whole limbs and
+    // `rest` decimal digits, 0 <= rest < BASE_DIGITS, without materializing it
+
+    // Limb i of the shifted b
+    inline uint64_t shiftedLimb(const uint64_t *b, size_t nb, size_t limbs, int rest, size_t i)
+    {
+        if (i < limbs)
+            return 0;
+
+        size_t j = i - limbs;
+        uint64_t low = j < nb ? b[j] : 0;
+
+        if (rest == 0)
+            return low;
+
+        uint64_t high = (j >= 1 && j - 1 < nb) ? b[j - 1] : 0;
+
+        return low % POW10[BASE_DIGITS - rest] * POW10[rest] + high / POW10[BASE_DIGITS - rest];
+    }
+
+    // Number of limbs in the shifted b, nb must be non-zero
+    size_t shiftedSize(const uint64_t *b, size_t nb, size_t limbs, int rest);
+
+    // Compares a with the shifted b
+    int compareShifted(const uint64_t *a, size_t na, const uint64_t *b, size_t nb, size_t limbs,
+                       int rest);
+
+    // r += shifted b, returns the carry out of r[nr - 1]
+    uint64_t addShifted(uint64_t *r, size_t nr, const uint64_t *b, size_t nb, size_t limbs,
+                        int rest);
+
+    // r -= shifted b, requires r >= shifted b
+    void subShifted(uint64_t *r, size_t nr, const uint64_t *b, size_t nb, size_t limbs, int rest);
+
+    // r = shifted b - r, requires shifted b >= r and nr >= shiftedSize
+    void subFromShifted(uint64_t *r, size_t nr, const uint64_t *b, size_t nb, size_t limbs,
+                        int rest);
+
+    // Products of operands shorter than this are not split any further
+    const size_t KARATSUBA_THRESHOLD = 64;
+    const size_t SQR_KARATSUBA_THRESHOLD = 96;
+
+    // Shorter operand sizes from which Toom-3 (and Toom-3/2) and Toom-4 are used
+    const size_t TOOM3_THRESHOLD = 800;
+    const size_t TOOM4_THRESHOLD = 2000;
+
+    // Shorter operand size from which the number theoretic transform is used
+    const size_t NTT_THRESHOLD = 2500;
+
+    // The multiplications below write na + nb limbs to r, which must not
+    // overlap the inputs
+
+    // r = a * b in quadratic time
+    void mulSchoolbook(uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b, size_t nb);
+
+    // r = a * a in about half the products of mulSchoolbook
+    void sqrSchoolbook(uint64_t *r, const uint64_t *a, size_t n);
+
+    // Limbs of scratch needed by mulKaratsuba and mul
+    size_t karatsubaScratchSize(size_t n);
+    size_t mulScratchSize(size_t na, size_t nb);
+    size_t sqrKaratsubaScratchSize(size_t n);
+    size_t sqrScratchSize(size_t n);
+
+    // r = a * b for two n limb operands
+    void mulKaratsuba(uint64_t *r, const uint64_t *a, const uint64_t *b, size_t n,
+                      uint64_t *scratch);
+
+    // r = a * a for an n limb operand
+    void sqrKaratsuba(uint64_t *r, const uint64_t *a, size_t n, uint64_t *scratch);
+
+    // r = a * b with a split into ka and b into kb pieces, ka + kb <= 8,
+    // allocates its own temporaries
+    void mulToom(uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b, size_t nb, int ka,
+                 int kb);
+
+    // r = a * b by three-prime number theoretic transforms, exact for
+    // operands of up to 2^50 limbs, allocates its own temporaries
+    void mulNtt(uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b, size_t nb);
+
+    // r = a * b, picks schoolbook, Karatsuba, Toom or NTT by size and cuts
+    // operands of very different lengths into balanced pieces
+    void mul(uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b, size_t nb,
+             uint64_t *scratch);
+
+    // Same as above with scratch allocated for the call
+    void mul(uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b, size_t nb);
+
+    // r = a * a, writes 2n limbs, the tiers are the same as for mul
+    // mul and mulToom come here by themselves when both operands are the
+    // same array, mulNtt transforms it once
+    void sqr(uint64_t *r, const uint64_t *a, size_t n, uint64_t *scratch);
+    void sqr(uint64_t *r, const uint64_t *a, size_t n);
+
+    // Divisor and quotient size from which division goes through a Newton
+    // reciprocal instead of the schoolbook method
+    const size_t DIV_NEWTON_THRESHOLD = 64;
+
+    // The divisions below write na - nb + 1 limbs of q = a / b to q and nb
+    // limbs of a mod b to r, neither of which may overlap the inputs, and
+    // require na >= nb and b[nb - 1] != 0
+
+    // q = a / b in quadratic time
+    void divSchoolbook(uint64_t *q, uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b,
+                       size_t nb);
+
+    // q = a / b in a few multiplications of the divisor size, requires
+    // nb >= 2 and allocates its own temporaries
+    void divNewton(uint64_t *q, uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b,
+                   size_t nb);
+
+    // q = a / b, picks divSmall, schoolbook or Newton by size
+    void div(uint64_t *q, uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b, size_t nb);
+
+    // r = gcd(a, b), which is a when b is zero, r needs room for
+    // max(na, nb) limbs, returns the number written, allocates its own
+    // temporaries
+    size_t gcd(uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b, size_t nb);
+}
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// Growable array of limbs which keeps up to INLINE_LIMBS limbs inside the
+// object itself and only goes to the heap once it grows past them
+class LimbBuffer
+{
+public:
+    static const size_t INLINE_LIMBS = 4;
+
+    typedef uint64_t *iterator;
+    typedef const uint64_t *const_iterator;
+
+    LimbBuffer() : _data(_inline), _size(0), _capacity(INLINE_LIMBS)
+    {
+    }
+
+    LimbBuffer(size_t count, uint64_t value) : LimbBuffer()
+    {
+        assign(count, value);
+    }
+
+    LimbBuffer(const LimbBuffer &other) : LimbBuffer()
+    {
+        assign(other.begin(), other.end());
+    }
+
+    LimbBuffer(LimbBuffer &&other) noexcept : LimbBuffer()
+    {
+        steal(other);
+    }
+
+    ~LimbBuffer()
+    {
+        if (isOnHeap())
+            std::free(_data);
+    }
+
+    LimbBuffer &operator=(const LimbBuffer &other)
+    {
+        if (this != &other)
+            assign(other.begin(), other.end());
+        return *this;
+    }
+
+    LimbBuffer &operator=(LimbBuffer &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (isOnHeap())
+                std::free(_data);
+            _data = _inline;
+            _size = 0;
+            _capacity = INLINE_LIMBS;
+            steal(other);
+        }
+        return *this;
+    }
+
+    size_t size() const
+    {
+        return _size;
+    }
+    size_t capacity() const
+    {
+        return _capacity;
+    }
+    bool empty() const
+    {
+        return _size == 0;
+    }
+
+    uint64_t *data()
+    {
+        return _data;
+    }
+    const uint64_t *data() const
+    {
+        return _data;
+    }
+
+    iterator begin()
+    {
+        return _data;
+    }
+    iterator end()
+    {
+        return _data + _size;
+    }
+    const_iterator begin() const
+    {
+        return _data;
+    }
+    const_iterator end() const
+    {
+        return _data + _size;
+    }
+
+    uint64_t &operator[](size_t i)
+    {
+        return _data[i];
+    }
+    const uint64_t &operator[](size_t i) const
+    {
+        return _data[i];
+    }
+
+    uint64_t &back()
+    {
+        return _data[_size - 1];
+    }
+    const uint64_t &back() const
+    {
+        return _data[_size - 1];
+    }
+
+    void reserve(size_t capacity)
+    {
+        if (capacity > _capacity)
+            grow(capacity);
+    }
+
+    void clear()
+    {
+        _size = 0;
+    }
+
+    // New limbs are zero
+    void resize(size_t size)
+    {
+        reserve(size);
+        if (size > _size)
+            std::memset(_data + _size, 0, (size - _size) * sizeof(uint64_t));
+        _size = size;
+    }
+
+    void push_back(uint64_t limb)
+    {
+        if (_size == _capacity)
+            grow(_capacity * 2);
+        _data[_size++] = limb;
+    }
+
+    void pop_back()
+    {
+        _size--;
+    }
+
+    void assign(size_t count, uint64_t value)
+    {
+        _size = 0;
+        reserve(count);
+        for (size_t i = 0; i < count; i++)
+            _data[i] = value;
+        _size = count;
+    }
+
+    // [first; last) must not point into this buffer
+    void assign(const uint64_t *first, const uint64_t *last)
+    {
+        size_t count = last - first;
+
+        _size = 0;
+        reserve(count);
+        if (count)
+            std::memcpy(_data, first, count * sizeof(uint64_t));
+        _size = count;
+    }
+
+    iterator insert(iterator pos, size_t count, uint64_t value)
+    {
+        size_t index = pos - _data;
+
+        reserve(_size + count);
+        std::memmove(_data + index + count, _data + index, (_size - index) * sizeof(uint64_t));
+        for (size_t i = 0; i < count; i++)
+            _data[index + i] = value;
+        _size += count;
+
+        return _data + index;
+    }
+
+    iterator insert(iterator pos, uint64_t value)
+    {
+        return insert(pos, 1, value);
+    }
+
+    iterator erase(iterator first, iterator last)
+    {
+        std::memmove(first, last, (end() - last) * sizeof(uint64_t));
+        _size -= last - first;
+        return first;
+    }
+
+    bool operator==(const LimbBuffer &other) const
+    {
+        return _size == other._size &&
+               (_size == 0 || std::memcmp(_data, other._data, _size * sizeof(uint64_t)) == 0);
+    }
+
+    bool operator!=(const LimbBuffer &other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    uint64_t *_data;
+    size_t _size;
+    size_t _capacity;
+    uint64_t _inline[INLINE_LIMBS];
+
+    bool isOnHeap() const
+    {
+        return _data != _inline;
+    }
+
+    void grow(size_t capacity)
+    {
+        if (capacity < _capacity * 2)
+            capacity = _capacity * 2;
+
+        uint64_t *data = static_cast<uint64_t *>(std::malloc(capacity * sizeof(uint64_t)));
+        if (!data)
+            throw std::bad_alloc();
+
+        if (_size)
+            std::memcpy(data, _data, _size * sizeof(uint64_t));
+        if (isOnHeap())
+            std::free(_data);
+
+        _data = data;
+        _capacity = capacity;
+    }
+
+    // Takes the heap block of `other` or copies its inline limbs
+    void steal(LimbBuffer &other)
+    {
+        if (other.isOnHeap())
+        {
+            _data = other._data;
+            _capacity = other._capacity;
+            other._data = other._inline;
+            other._capacity = INLINE_LIMBS;
+        }
+        else
+        {
+            std::memcpy(_inline, other._inline, other._size * sizeof(uint64_t));
+        }
+        _size = other._size;
+        other._size = 0;
+    }
+};
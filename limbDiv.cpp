@@ -0,0 +1,248 @@
+#include "limbArith.h"
+#include <algorithm>
+#include <vector>
+
+// Division of limb arrays: schoolbook for short operands and a Newton
+// reciprocal, which brings the cost down to a few multiplications, above
+namespace LimbArith
+{
+    namespace
+    {
+        size_t trimmedSize(const uint64_t *a, size_t n)
+        {
+            while (n > 0 && a[n - 1] == 0)
+                n--;
+            return n;
+        }
+
+        // x = BASE^(2n) / d up to a few units, d has n limbs and its top
+        // limb is at least BASE / 2, writes n + 2 limbs to x
+        //
+        // The top half of d gives x0 = BASE^(2m) / dh recursively, one Newton
+        // step x = x0 + x0 * (BASE^(2n) - d * x0) / BASE^(2n) doubles the
+        // number of correct limbs
+        void reciprocal(uint64_t *x, const uint64_t *d, size_t n)
+        {
+            std::fill(x, x + n + 2, 0);
+
+            if (n < DIV_NEWTON_THRESHOLD)
+            {
+                std::vector<uint64_t> num(2 * n + 1, 0);
+                std::vector<uint64_t> rem(n);
+                num[2 * n] = 1;
+                divSchoolbook(x, rem.data(), num.data(), num.size(), d, n);
+                return;
+            }
+
+            size_t m = n / 2 + 1;
+            std::vector<uint64_t> xh(m + 2);
+            reciprocal(xh.data(), d + n - m, m);
+            size_t nxh = trimmedSize(xh.data(), xh.size());
+
+            // e = |BASE^(n + m) - d * xh|, which is about BASE^(n + 1)
+            std::vector<uint64_t> e(std::max(n + nxh, n + m + 1));
+            mul(e.data(), d, n, xh.data(), nxh);
+            size_t ne = trimmedSize(e.data(), n + nxh);
+
+            std::vector<uint64_t> power(n + m + 1, 0);
+            power[n + m] = 1;
+            bool tooLarge = compare(e.data(), ne, power.data(), power.size()) > 0;
+            if (tooLarge)
+            {
+                sub(e.data(), e.data(), ne, power.data(), power.size());
+            }
+            else
+            {
+                sub(power.data(), power.data(), power.size(), e.data(), ne);
+                std::copy(power.begin(), power.end(), e.begin());
+                ne = power.size();
+            }
+            ne = trimmedSize(e.data(), ne);
+
+            // The correction xh * e / BASE^(2m) is needed to the unit only,
+            // so the low m - 2 limbs of e are dropped
+            size_t dropped = std::min(m - 2, ne);
+            std::vector<uint64_t> correction(nxh + ne - dropped + 1, 0);
+            if (ne > dropped)
+                mul(correction.data(), xh.data(), nxh, e.data() + dropped, ne - dropped);
+
+            size_t shift = 2 * m - dropped;
+            size_t nc = trimmedSize(correction.data(), correction.size());
+            const uint64_t *c = correction.data() + std::min(shift, nc);
+            nc = nc > shift ? nc - shift : 0;
+
+            std::copy(xh.begin(), xh.begin() + nxh, x + n - m);
+            if (tooLarge)
+                sub(x, x, n + 2, c, nc);
+            else
+                add(x, x, n + 2, c, nc);
+        }
+
+        // q = r / b for r < b * BASE^len and r = r mod b, b is normalized with
+        // x its reciprocal over the top n limbs, writes len limbs to q
+        //
+        // The estimate from the top of r is off by a few units at most and
+        // is fixed up against the exact remainder
+        void divBlock(uint64_t *q, size_t len, std::vector<uint64_t> &r, const uint64_t *b,
+                      size_t nb, const uint64_t *x, size_t nx, size_t n)
+        {
+            std::fill(q, q + len, 0);
+
+            size_t nr = trimmedSize(r.data(), r.size());
+            if (nr < nb)
+                return;
+
+            // Dropping the low nb - 1 limbs of r moves the estimate by less
+            // than a unit, it is then r * x / BASE^(2n + nb - n)
+            const uint64_t *top = r.data() + nb - 1;
+            size_t nTop = nr - (nb - 1);
+
+            std::vector<uint64_t> estimate(nTop + nx);
+            mul(estimate.data(), top, nTop, x, nx);
+
+            size_t ne = trimmedSize(estimate.data(), estimate.size());
+            std::vector<uint64_t> qs(len + 2, 0);
+            if (ne > n + 1)
+                std::copy(estimate.begin() + n + 1,
+                          estimate.begin() + std::min(ne, n + 1 + qs.size()), qs.begin());
+            size_t nq = trimmedSize(qs.data(), qs.size());
+
+            std::vector<uint64_t> product(nq + nb + 1, 0);
+            if (nq > 0)
+                mul(product.data(), qs.data(), nq, b, nb);
+            size_t np = trimmedSize(product.data(), product.size());
+
+            uint64_t one = 1;
+            while (compare(product.data(), np, r.data(), nr) > 0)
+            {
+                sub(qs.data(), qs.data(), nq, &one, 1);
+                nq = trimmedSize(qs.data(), nq);
+                sub(product.data(), product.data(), np, b, nb);
+                np = trimmedSize(product.data(), np);
+            }
+
+            sub(r.data(), r.data(), nr, product.data(), np);
+            nr = trimmedSize(r.data(), nr);
+
+            while (compare(r.data(), nr, b, nb) >= 0)
+            {
+                qs[len + 1] += add(qs.data(), qs.data(), len + 1, &one, 1);
+                sub(r.data(), r.data(), nr, b, nb);
+                nr = trimmedSize(r.data(), nr);
+            }
+
+            std::copy(qs.begin(), qs.begin() + len, q);
+        }
+    }
+
+    // Knuth, TAOCP vol. 2, 4.3.1, Algorithm D. With the top limb of b at
+    // least BASE / 2, the estimate from the top two limbs of the remainder,
+    // checked against the third, is at most one too large
+    void divSchoolbook(uint64_t *q, uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b,
+                       size_t nb)
+    {
+        uint64_t factor = BASE / (b[nb - 1] + 1);
+
+        std::vector<uint64_t> u(na + 1);
+        std::vector<uint64_t> v(nb);
+        u[na] = mulSmall(u.data(), a, na, factor);
+        mulSmall(v.data(), b, nb, factor);
+
+        uint64_t v1 = v[nb - 1];
+        uint64_t v2 = nb > 1 ? v[nb - 2] : 0;
+
+        for (size_t j = na - nb + 1; j-- > 0;)
+        {
+            uint64_t *uj = u.data() + j;
+
+            uint128 top = (uint128)uj[nb] * BASE + uj[nb - 1];
+            uint128 qhat = top / v1;
+            uint128 rhat = top % v1;
+            uint64_t u2 = nb > 1 ? uj[nb - 2] : 0;
+
+            while (qhat >= BASE || qhat * v2 > rhat * BASE + u2)
+            {
+                qhat--;
+                rhat += v1;
+                if (rhat >= BASE)
+                    break;
+            }
+
+            // uj -= qhat * v
+            uint64_t carry = 0, borrow = 0;
+            for (size_t i = 0; i < nb; i++)
+            {
+                uint64_t low;
+                uint128 t = (uint128)(uint64_t)qhat * v[i] + carry;
+                carry = divBase((uint64_t)(t >> 64), (uint64_t)t, low);
+
+                uint64_t toSubtract = low + borrow;
+                borrow = uj[i] < toSubtract;
+                uj[i] = uj[i] - toSubtract + (BASE & (0 - borrow));
+            }
+            uint64_t toSubtract = carry + borrow;
+            borrow = uj[nb] < toSubtract;
+            uj[nb] -= toSubtract;
+
+            // qhat was one too large, v is added back once
+            if (borrow)
+            {
+                qhat--;
+                uj[nb] += add(uj, uj, nb, v.data(), nb);
+            }
+
+            q[j] = (uint64_t)qhat;
+        }
+
+        divSmall(r, u.data(), nb, factor);
+    }
+
+    // Both operands are scaled so that the top limb of b is at least
+    // BASE / 2, which keeps the reciprocal accurate to a few units. The
+    // quotient is then taken in blocks of n - 1 limbs, one multiplication
+    // by the reciprocal each
+    void divNewton(uint64_t *q, uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b,
+                   size_t nb)
+    {
+        uint64_t factor = BASE / (b[nb - 1] + 1);
+
+        std::vector<uint64_t> an(na + 1);
+        std::vector<uint64_t> bn(nb);
+        an[na] = mulSmall(an.data(), a, na, factor);
+        mulSmall(bn.data(), b, nb, factor);
+
+        size_t nq = na - nb + 1;
+        size_t n = std::min(nb, nq + 1);
+        size_t step = n - 1;
+
+        std::vector<uint64_t> x(n + 2);
+        reciprocal(x.data(), bn.data() + nb - n, n);
+        size_t nx = trimmedSize(x.data(), x.size());
+
+        // the top nb limbs of a are less than b, the rest is brought
+        // down `step` limbs at a time
+        std::vector<uint64_t> rem(an.end() - nb, an.end());
+        size_t pos = nq;
+        while (pos > 0)
+        {
+            size_t len = std::min(step, pos);
+            pos -= len;
+
+            rem.insert(rem.begin(), an.begin() + pos, an.begin() + pos + len);
+            divBlock(q + pos, len, rem, bn.data(), nb, x.data(), nx, n);
+            rem.resize(nb);
+        }
+
+        divSmall(r, rem.data(), nb, factor);
+    }
+
+    void div(uint64_t *q, uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b, size_t nb)
+    {
+        if (nb == 1)
+            r[0] = divSmall(q, a, na, b[0]);
+        else if (std::min(nb, na - nb + 1) < DIV_NEWTON_THRESHOLD)
+            divSchoolbook(q, r, a, na, b, nb);
+        else
+            divNewton(q, r, a, na, b, nb);
+    }
+}
@@ -0,0 +1,171 @@
+#include "limbArith.h"
+#include <algorithm>
+#include <vector>
+
+// Greatest common divisors of limb arrays: Lehmer's algorithm while the
+// operands are longer than two limbs, Stein's binary algorithm below
+namespace LimbArith
+{
+    namespace
+    {
+        size_t trimmedSize(const uint64_t *a, size_t n)
+        {
+            while (n > 0 && a[n - 1] == 0)
+                n--;
+            return n;
+        }
+
+        uint64_t limbAt(const std::vector<uint64_t> &a, size_t n, size_t i)
+        {
+            return i < n ? a[i] : 0;
+        }
+
+        int trailingBits(uint128 x)
+        {
+            uint64_t low = (uint64_t)x;
+            return low ? __builtin_ctzll(low) : 64 + __builtin_ctzll((uint64_t)(x >> 64));
+        }
+
+        // Stein's algorithm, which only shifts and subtracts
+        uint128 binaryGcd(uint128 a, uint128 b)
+        {
+            if (a == 0)
+                return b;
+            if (b == 0)
+                return a;
+
+            int shift = trailingBits(a | b);
+            a >>= trailingBits(a);
+            while (b != 0)
+            {
+                b >>= trailingBits(b);
+                if (a > b)
+                    std::swap(a, b);
+                b -= a;
+            }
+            return a << shift;
+        }
+
+        uint128 twoLimbs(const std::vector<uint64_t> &a, size_t n)
+        {
+            return (uint128)limbAt(a, n, 1) * BASE + limbAt(a, n, 0);
+        }
+
+        // r = |x * a - y * b| for x, y < BASE, r has room for n + 1 limbs
+        // where n >= na, nb, which also bounds the result
+        void combine(std::vector<uint64_t> &r, const std::vector<uint64_t> &a, size_t na,
+                     uint64_t x, const std::vector<uint64_t> &b, size_t nb, uint64_t y,
+                     bool aFirst, size_t n, std::vector<uint64_t> &scratch)
+        {
+            std::fill(r.begin(), r.begin() + n + 1, 0);
+            std::fill(scratch.begin(), scratch.begin() + n + 1, 0);
+            r[na] = mulSmall(r.data(), a.data(), na, x);
+            scratch[nb] = mulSmall(scratch.data(), b.data(), nb, y);
+
+            if (aFirst)
+                sub(r.data(), r.data(), n + 1, scratch.data(), n + 1);
+            else
+                sub(r.data(), scratch.data(), n + 1, r.data(), n + 1);
+        }
+    }
+
+    // Knuth, TAOCP vol. 2, 4.5.2, Algorithm L. Euclid's steps are run on
+    // the leading 18 digits of both operands for as long as the quotients
+    // are certain to be the true ones, then applied to the full operands at
+    // once as u' = A u + B v, v' = C u + D v
+    size_t gcd(uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b, size_t nb)
+    {
+        size_t size = std::max(na, nb) + 1;
+        std::vector<uint64_t> u(size, 0), v(size, 0), w(size, 0), x(size, 0), scratch(size, 0);
+        std::copy(a, a + na, u.begin());
+        std::copy(b, b + nb, v.begin());
+
+        size_t nu = trimmedSize(u.data(), na);
+        size_t nv = trimmedSize(v.data(), nb);
+        if (compare(u.data(), nu, v.data(), nv) < 0)
+        {
+            u.swap(v);
+            std::swap(nu, nv);
+        }
+
+        std::vector<uint64_t> q(size);
+        while (nv > 2)
+        {
+            int64_t A = 1, B = 0, C = 0, D = 1;
+
+            if (nv + 1 >= nu)
+            {
+                // the same window of both, scaled below 10^18
+                uint128 top = (uint128)u[nu - 1] * BASE + u[nu - 2];
+                uint128 bottom = (uint128)limbAt(v, nv, nu - 1) * BASE + v[nu - 2];
+                int t = digitCount(u[nu - 1]) + 1;
+                uint128 scale = (uint128)POW10[t / 2] * POW10[t - t / 2];
+
+                int64_t uh = (int64_t)(top / scale);
+                int64_t vh = (int64_t)(bottom / scale);
+
+                while (vh + C > 0 && vh + D > 0)
+                {
+                    int64_t quotient = (uh + A) / (vh + C);
+                    if (quotient != (uh + B) / (vh + D))
+                        break;
+
+                    int64_t t0 = A - quotient * C;
+                    A = C;
+                    C = t0;
+                    t0 = B - quotient * D;
+                    B = D;
+                    D = t0;
+                    t0 = uh - quotient * vh;
+                    uh = vh;
+                    vh = t0;
+                }
+            }
+
+            if (B == 0)
+            {
+                // no quotient was certain, one full division step
+                div(q.data(), w.data(), u.data(), nu, v.data(), nv);
+                u.swap(v);
+                v.swap(w);
+                nu = nv;
+                nv = trimmedSize(v.data(), nu);
+                continue;
+            }
+
+            // A and B have opposite signs, as do C and D
+            combine(w, u, nu, A < 0 ? -A : A, v, nv, B < 0 ? -B : B, B < 0, nu, scratch);
+            combine(x, u, nu, C < 0 ? -C : C, v, nv, D < 0 ? -D : D, D < 0, nu, scratch);
+            u.swap(w);
+            v.swap(x);
+
+            nu = trimmedSize(u.data(), nu + 1);
+            nv = trimmedSize(v.data(), nu);
+        }
+
+        uint128 res;
+        if (nv == 0)
+        {
+            std::copy(u.begin(), u.begin() + nu, r);
+            return nu;
+        }
+        else if (nu > 2)
+        {
+            div(q.data(), w.data(), u.data(), nu, v.data(), nv);
+            res = binaryGcd(twoLimbs(v, nv), twoLimbs(w, nv));
+        }
+        else
+        {
+            res = binaryGcd(twoLimbs(u, nu), twoLimbs(v, nv));
+        }
+
+        // two limbs only when both operands had them
+        if (res == 0)
+            return 0;
+        r[0] = (uint64_t)(res % BASE);
+        if (res < BASE)
+            return 1;
+        r[1] = (uint64_t)(res / BASE);
+        return 2;
+    }
+}
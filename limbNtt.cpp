@@ -0,0 +1,261 @@
+#include "limbArith.h"
+#include <stdexcept>
+#include <vector>
+
+// Multiplication by number theoretic transforms modulo three primes whose
+// product exceeds every coefficient of the convolution, the exact
+// coefficients are put back together by the Chinese remainder theorem
+namespace LimbArith
+{
+    namespace
+    {
+        // Arithmetic modulo an odd prime p < 2^62 in Montgomery form,
+        // a residue x is kept as x * 2^64 mod p
+        class Montgomery
+        {
+        public:
+            Montgomery(uint64_t p, uint64_t generator) : _p(p)
+            {
+                // p^-1 mod 2^64 by Newton's iteration, p * p = 1 mod 8
+                uint64_t inv = p;
+                for (int i = 0; i < 5; i++)
+                    inv *= 2 - p * inv;
+                _negInv = 0 - inv;
+
+                uint64_t r = (uint64_t)(((uint128)1 << 64) % p);
+                _r2 = (uint64_t)((uint128)r * r % p);
+                _one = r;
+                _generator = toMont(generator);
+            }
+
+            uint64_t modulus() const
+            {
+                return _p;
+            }
+
+            uint64_t one() const
+            {
+                return _one;
+            }
+
+            // t * 2^-64 mod p for t < p * 2^64
+            uint64_t reduce(uint128 t) const
+            {
+                uint64_t m = (uint64_t)t * _negInv;
+                uint64_t res = (uint64_t)((t + (uint128)m * _p) >> 64);
+                return res >= _p ? res - _p : res;
+            }
+
+            uint64_t mul(uint64_t a, uint64_t b) const
+            {
+                return reduce((uint128)a * b);
+            }
+
+            uint64_t add(uint64_t a, uint64_t b) const
+            {
+                uint64_t s = a + b;
+                return s >= _p ? s - _p : s;
+            }
+
+            uint64_t sub(uint64_t a, uint64_t b) const
+            {
+                return a >= b ? a - b : a + _p - b;
+            }
+
+            uint64_t toMont(uint64_t a) const
+            {
+                return mul(a % _p, _r2);
+            }
+
+            uint64_t fromMont(uint64_t a) const
+            {
+                return reduce(a);
+            }
+
+            uint64_t pow(uint64_t a, uint64_t e) const
+            {
+                uint64_t res = _one;
+                for (; e; e >>= 1)
+                {
+                    if (e & 1)
+                        res = mul(res, a);
+                    a = mul(a, a);
+                }
+                return res;
+            }
+
+            // Primitive n-th root of unity in Montgomery form, n | p - 1
+            uint64_t root(uint64_t n) const
+            {
+                return pow(_generator, (_p - 1) / n);
+            }
+
+        private:
+            uint64_t _p;
+            uint64_t _negInv;
+            uint64_t _r2;
+            uint64_t _one;
+            uint64_t _generator;
+        };
+
+        // c * 2^50 + 1 with a primitive root, p1 * p2 * p3 > 2^182
+        const Montgomery PRIMES[3] = {Montgomery(2287828610704211969ULL, 3),
+                                      Montgomery(2276569611635785729ULL, 11),
+                                      Montgomery(2254051613498933249ULL, 3)};
+
+        const int MAX_LOG_LENGTH = 50;
+
+        // Twiddle factors w^j for j < n / 2 where w is a primitive n-th root
+        void twiddles(const Montgomery &m, uint64_t w, size_t n, std::vector<uint64_t> &table)
+        {
+            table.resize(n / 2);
+            uint64_t cur = m.one();
+            for (size_t j = 0; j < n / 2; j++)
+            {
+                table[j] = cur;
+                cur = m.mul(cur, w);
+            }
+        }
+
+        // Decimation in frequency, leaves the transform in bit reversed order
+        void forward(const Montgomery &m, uint64_t *a, size_t n, const std::vector<uint64_t> &w)
+        {
+            for (size_t len = n / 2, stride = 1; len >= 1; len /= 2, stride *= 2)
+            {
+                for (size_t i = 0; i < n; i += 2 * len)
+                {
+                    for (size_t j = 0; j < len; j++)
+                    {
+                        uint64_t u = a[i + j];
+                        uint64_t v = a[i + j + len];
+                        a[i + j] = m.add(u, v);
+                        a[i + j + len] = m.mul(m.sub(u, v), w[j * stride]);
+                    }
+                }
+            }
+        }
+
+        // Decimation in time from bit reversed order, w holds inverse roots
+        void inverse(const Montgomery &m, uint64_t *a, size_t n, const std::vector<uint64_t> &w)
+        {
+            for (size_t len = 1, stride = n / 2; len < n; len *= 2, stride /= 2)
+            {
+                for (size_t i = 0; i < n; i += 2 * len)
+                {
+                    for (size_t j = 0; j < len; j++)
+                    {
+                        uint64_t u = a[i + j];
+                        uint64_t v = m.mul(a[i + j + len], w[j * stride]);
+                        a[i + j] = m.add(u, v);
+                        a[i + j + len] = m.sub(u, v);
+                    }
+                }
+            }
+        }
+
+        // Cyclic convolution of a and b modulo one prime, the result is
+        // written to res in normal form, a square takes one forward transform
+        void convolve(const Montgomery &m, const uint64_t *a, size_t na, const uint64_t *b,
+                      size_t nb, size_t n, uint64_t *res, std::vector<uint64_t> &work)
+        {
+            std::vector<uint64_t> w;
+            bool square = a == b && na == nb;
+
+            for (size_t i = 0; i < na; i++)
+                res[i] = m.toMont(a[i]);
+            for (size_t i = na; i < n; i++)
+                res[i] = 0;
+
+            twiddles(m, m.root(n), n, w);
+            forward(m, res, n, w);
+
+            if (square)
+            {
+                for (size_t i = 0; i < n; i++)
+                    res[i] = m.mul(res[i], res[i]);
+            }
+            else
+            {
+                work.assign(n, 0);
+                for (size_t i = 0; i < nb; i++)
+                    work[i] = m.toMont(b[i]);
+                forward(m, work.data(), n, w);
+
+                for (size_t i = 0; i < n; i++)
+                    res[i] = m.mul(res[i], work[i]);
+            }
+
+            // the inverse transform also divides by n
+            uint64_t root = m.root(n);
+            twiddles(m, m.pow(root, n - 1), n, w);
+            inverse(m, res, n, w);
+
+            uint64_t nInv = m.pow(m.toMont(n), m.modulus() - 2);
+            for (size_t i = 0; i < n; i++)
+                res[i] = m.fromMont(m.mul(res[i], nInv));
+        }
+    }
+
+    void mulNtt(uint64_t *r, const uint64_t *a, size_t na, const uint64_t *b, size_t nb)
+    {
+        size_t count = na + nb - 1;
+        size_t n = 1;
+        int log = 0;
+        while (n < count)
+        {
+            n *= 2;
+            log++;
+        }
+        if (log > MAX_LOG_LENGTH)
+            throw std::length_error("Operands are too long for the transform");
+
+        std::vector<uint64_t> residues(3 * n);
+        std::vector<uint64_t> work;
+        for (int k = 0; k < 3; k++)
+            convolve(PRIMES[k], a, na, b, nb, n, residues.data() + k * n, work);
+
+        const Montgomery &m2 = PRIMES[1];
+        const Montgomery &m3 = PRIMES[2];
+        uint64_t p1 = PRIMES[0].modulus();
+        uint64_t p2 = m2.modulus();
+
+        // Garner's constants in Montgomery form, so that multiplying a
+        // residue in normal form by them gives a residue in normal form
+        uint64_t p1InvMod2 = m2.pow(m2.toMont(p1), p2 - 2);
+        uint64_t p1InvMod3 = m3.pow(m3.toMont(p1), m3.modulus() - 2);
+        uint64_t p2InvMod3 = m3.pow(m3.toMont(p2), m3.modulus() - 2);
+
+        uint128 carry = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            uint64_t r1 = residues[i];
+            uint64_t r2 = residues[n + i];
+            uint64_t r3 = residues[2 * n + i];
+
+            // x = v1 + p1 * (v2 + p2 * v3)
+            uint64_t v1 = r1;
+            uint64_t v2 = m2.mul(m2.sub(r2, v1 % p2), p1InvMod2);
+            uint64_t v3 = m3.mul(m3.sub(r3, v1 % m3.modulus()), p1InvMod3);
+            v3 = m3.mul(m3.sub(v3, v2 % m3.modulus()), p2InvMod3);
+
+            uint128 y = (uint128)p2 * v3 + v2;
+            uint128 low = (uint128)p1 * (uint64_t)y;
+            uint128 high = (uint128)p1 * (uint64_t)(y >> 64) + (low >> 64);
+
+            // x + carry as three words w2 w1 w0
+            uint128 sum = (uint128)(uint64_t)low + v1 + (uint64_t)carry;
+            uint64_t w0 = (uint64_t)sum;
+            sum = (sum >> 64) + (uint64_t)high + (uint64_t)(carry >> 64);
+            uint64_t w1 = (uint64_t)sum;
+            uint64_t w2 = (uint64_t)(sum >> 64) + (uint64_t)(high >> 64);
+
+            uint64_t rem;
+            uint64_t qHigh = divBase(w2, w1, rem);
+            uint64_t qLow = divBase(rem, w0, r[i]);
+            carry = ((uint128)qHigh << 64) | qLow;
+        }
+
+        // the product has na + nb limbs, so what is left fits the last one
+        r[count] = (uint64_t)carry;
+    }
+}